@@ -18,10 +18,22 @@ CONFIG-=app_bundle
 # Auto include all .cpp files in the project src directory (can specifiy individually if required)
 SOURCES+= $$PWD/src/main.cpp \
           $$PWD/src/NGLScene.cpp \
-          $$PWD/src/NGLSceneMouseControls.cpp
+          $$PWD/src/NGLSceneMouseControls.cpp \
+          $$PWD/src/GridOptions.cpp \
+          $$PWD/src/RenderScheduler.cpp \
+          $$PWD/src/RenderThread.cpp \
+          $$PWD/src/FrameLatency.cpp
 # same for the .h files
 HEADERS+= $$PWD/include/NGLScene.h \
-          $$PWD/include/WindowParams.h
+          $$PWD/include/WindowParams.h \
+          $$PWD/include/GridOptions.h \
+          $$PWD/include/RenderScheduler.h \
+          $$PWD/include/RenderThread.h \
+          $$PWD/include/TripleBuffer.h \
+          $$PWD/include/SceneState.h \
+          $$PWD/include/FrameLatency.h
+# the renderer sources shared by the app and the benchmark
+include($$PWD/GridRenderer.pri)
 # and add the include dir into the search path for Qt and make
 INCLUDEPATH +=./include
 # where our exe is going to live (root of project)
@@ -0,0 +1,40 @@
+# grid renderer sources shared by Grid.pro and GridBenchmark.pro
+SOURCES+= $$PWD/src/GridRenderer.cpp \
+          $$PWD/src/FrameTrace.cpp \
+          $$PWD/src/GridModel.cpp \
+          $$PWD/src/GridKernel.cpp \
+          $$PWD/src/JobSystem.cpp \
+          $$PWD/src/Frustum.cpp \
+          $$PWD/src/GridCuller.cpp \
+          $$PWD/src/GridLod.cpp \
+          $$PWD/src/ShaderProgram.cpp \
+          $$PWD/src/StreamBuffer.cpp \
+          $$PWD/src/ProgramCache.cpp \
+          $$PWD/src/FrameProfiler.cpp \
+          $$PWD/src/FrameCapture.cpp \
+          $$PWD/src/TileStreamer.cpp \
+          $$PWD/src/GridPicker.cpp \
+          $$PWD/src/RenderQueue.cpp \
+          $$PWD/src/FrameArena.cpp \
+          $$PWD/src/PoolAllocator.cpp
+HEADERS+= $$PWD/include/GridRenderer.h \
+          $$PWD/include/GridConfig.h \
+          $$PWD/include/FrameTrace.h \
+          $$PWD/include/GridModel.h \
+          $$PWD/include/GridKernel.h \
+          $$PWD/include/AlignedAllocator.h \
+          $$PWD/include/JobSystem.h \
+          $$PWD/include/Frustum.h \
+          $$PWD/include/GridCuller.h \
+          $$PWD/include/GridLod.h \
+          $$PWD/include/ShaderProgram.h \
+          $$PWD/include/UniformBlock.h \
+          $$PWD/include/StreamBuffer.h \
+          $$PWD/include/ProgramCache.h \
+          $$PWD/include/FrameProfiler.h \
+          $$PWD/include/FrameCapture.h \
+          $$PWD/include/TileStreamer.h \
+          $$PWD/include/GridPicker.h \
+          $$PWD/include/RenderQueue.h \
+          $$PWD/include/FrameArena.h \
+          $$PWD/include/PoolAllocator.h
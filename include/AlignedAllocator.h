@@ -0,0 +1,40 @@
+#ifndef ALIGNEDALLOCATOR_H_
+#define ALIGNEDALLOCATOR_H_
+#include <cstddef>
+#include <cstdint>
+#include <new>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file AlignedAllocator.h
+/// @brief std allocator returning memory aligned to Align bytes so SIMD kernels can use aligned
+/// loads and stores on std::vector storage. Takes its memory from operator new, padded by Align and the
+/// pointer to free, so the allocation counters of the benchmark see it like any other allocation.
+//----------------------------------------------------------------------------------------------------------------------
+
+template <typename T, size_t Align>
+class AlignedAllocator
+{
+  public:
+    typedef T value_type;
+    template <typename U> struct rebind { typedef AlignedAllocator<U, Align> other; };
+
+    AlignedAllocator()=default;
+    template <typename U> AlignedAllocator(const AlignedAllocator<U, Align> &) {}
+
+    T *allocate(size_t _n)
+    {
+      // the block operator new returned is stored just below the aligned pointer
+      char *raw = static_cast<char *>(::operator new(_n*sizeof(T)+Align+sizeof(void *)));
+      const uintptr_t first = reinterpret_cast<uintptr_t>(raw+sizeof(void *));
+      char *aligned = reinterpret_cast<char *>((first+Align-1) & ~static_cast<uintptr_t>(Align-1));
+      reinterpret_cast<void **>(aligned)[-1] = raw;
+      return reinterpret_cast<T *>(aligned);
+    }
+    void deallocate(T *_p, size_t) { ::operator delete(reinterpret_cast<void **>(_p)[-1]); }
+};
+
+template <typename T, typename U, size_t Align>
+bool operator==(const AlignedAllocator<T, Align> &, const AlignedAllocator<U, Align> &) { return true; }
+template <typename T, typename U, size_t Align>
+bool operator!=(const AlignedAllocator<T, Align> &, const AlignedAllocator<U, Align> &) { return false; }
+
+#endif
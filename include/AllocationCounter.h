@@ -0,0 +1,27 @@
+#ifndef ALLOCATIONCOUNTER_H_
+#define ALLOCATIONCOUNTER_H_
+#include <cstddef>
+#include <cstdint>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file AllocationCounter.h
+/// @brief counts every heap allocation made through the global operator new, on any thread. Linking
+/// AllocationCounter.cpp replaces operator new and delete (plain, array and nothrow) for the whole
+/// program with versions that count the call and its bytes before passing on to malloc, so it is only
+/// built into the benchmark. Raw malloc calls are not seen, the GL driver makes those every frame for
+/// its own fences and command buffers, and everything of ours allocates through new.
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace AllocationCounter
+{
+  struct Counts
+  {
+    uint64_t allocations=0;
+    uint64_t bytes=0;
+  };
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief totals since the program started, subtract two readings to get the allocations between them
+  //----------------------------------------------------------------------------------------------------------------------
+  Counts counts();
+}
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef FRAMEARENA_H_
+#define FRAMEARENA_H_
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file FrameArena.h
+/// @brief linear allocator for scratch data that only lives for one frame
+/// @class FrameArena
+/// @brief allocate() bumps a pointer through one block and reset() rewinds it at the start of the next
+/// frame, nothing is freed individually and no destructors run, so only trivially destructible types
+/// belong here. A frame that outgrows the block takes extra blocks from the heap, reset() then frees
+/// them and grows the block to the most that frame used, so after the first few frames a steady
+/// frame never touches the heap. Not thread safe, workers write into arrays allocated up front.
+//----------------------------------------------------------------------------------------------------------------------
+
+class FrameArena
+{
+  public:
+    struct Stats
+    {
+      /// bytes handed out since the last reset and the most any frame has used
+      size_t used=0;
+      size_t peak=0;
+      size_t capacity=0;
+      /// allocations that did not fit the block
+      uint64_t overflows=0;
+    };
+    explicit FrameArena(size_t _bytes=1u << 20);
+    FrameArena(const FrameArena &)=delete;
+    FrameArena &operator=(const FrameArena &)=delete;
+    ~FrameArena();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief uninitialised memory valid until the next reset, _alignment must be a power of two
+    //----------------------------------------------------------------------------------------------------------------------
+    void *allocate(size_t _bytes, size_t _alignment=alignof(std::max_align_t));
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief an uninitialised array of _count T, valid until the next reset
+    //----------------------------------------------------------------------------------------------------------------------
+    template <typename T>
+    T *allocate(size_t _count) { return static_cast<T *>(allocate(_count*sizeof(T), alignof(T))); }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief start a new frame, invalidates everything allocated so far
+    //----------------------------------------------------------------------------------------------------------------------
+    void reset();
+    const Stats &stats() const { return m_stats; }
+
+  private:
+    char *m_block=nullptr;
+    size_t m_head=0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the heap blocks of allocations that did not fit this frame, freed by reset
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<void *> m_overflow;
+    Stats m_stats;
+};
+
+#endif
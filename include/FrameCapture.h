@@ -0,0 +1,122 @@
+#ifndef FRAMECAPTURE_H_
+#define FRAMECAPTURE_H_
+#include <ngl/Types.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file FrameCapture.h
+/// @brief records rendered frames as an image sequence without stalling the render loop
+/// @class FrameCapture
+/// @brief capture() blits the finished frame into a single sampled FBO of the capture size, which resolves
+/// multisampling and scales if needed. It then starts a glReadPixels into the next of Slots persistently
+/// mapped pixel pack buffers and fences it. Later calls hand each slot whose fence has signalled to a
+/// background thread, which writes it as a PNG or raw RGBA file and frees the slot. If the next slot is
+/// still being read or encoded the frame is dropped and counted, the render loop never waits on the GPU
+/// or the disk.
+//----------------------------------------------------------------------------------------------------------------------
+
+class FrameCapture
+{
+  public:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief frames that can be in flight between the GPU and the disk
+    //----------------------------------------------------------------------------------------------------------------------
+    static constexpr uint32_t Slots = 4;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief Png writes frame_NNNNNN.png, Raw writes frame_NNNNNN.rgba, 8 bit RGBA rows from the bottom up
+    //----------------------------------------------------------------------------------------------------------------------
+    enum class Format { Png, Raw };
+    struct Counters
+    {
+      /// frames whose readback was started
+      uint64_t captured=0;
+      /// frames on disk
+      uint64_t written=0;
+      /// frames skipped because every slot was busy
+      uint64_t dropped=0;
+      /// frames read back or encoding but not written yet
+      uint32_t queued=0;
+    };
+    FrameCapture()=default;
+    FrameCapture(const FrameCapture &)=delete;
+    FrameCapture &operator=(const FrameCapture &)=delete;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief dtor stops the capture, the context used for capture() must be current
+    //----------------------------------------------------------------------------------------------------------------------
+    ~FrameCapture();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief create _directory and start the encoder thread, no GL calls so it can run before there is a
+    /// context. The buffers are made by the first capture().
+    /// @param [in] _width, _height the image size, 0 to use the size of the first captured frame
+    /// @returns false if the directory could not be created
+    //----------------------------------------------------------------------------------------------------------------------
+    bool start(const std::string &_directory, Format _format=Format::Png, int _width=0, int _height=0);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief finish the readbacks in flight, wait for the encoder and release the GL objects
+    //----------------------------------------------------------------------------------------------------------------------
+    void stop();
+    bool enabled() const { return m_enabled; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief queue the colour buffer of _framebuffer, call once the frame is drawn. The previous
+    /// framebuffer binding is not restored, _framebuffer is left bound.
+    //----------------------------------------------------------------------------------------------------------------------
+    void capture(GLuint _framebuffer, int _width, int _height);
+    Counters counters() const;
+
+  private:
+    enum SlotState : int { Free, Reading, Encoding };
+    struct Slot
+    {
+      GLuint buffer=0;
+      const unsigned char *data=nullptr;
+      GLsync fence=nullptr;
+      uint64_t frame=0;
+      std::atomic<int> state{Free};
+    };
+    void create();
+    void release();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief pass every slot whose readback has finished to the encoder, optionally waiting for them
+    //----------------------------------------------------------------------------------------------------------------------
+    void collect(bool _wait);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief body of the encoder thread
+    //----------------------------------------------------------------------------------------------------------------------
+    void encode();
+    void write(const Slot &_slot);
+
+    Slot m_slots[Slots];
+    uint32_t m_next=0;
+    std::string m_directory;
+    Format m_format=Format::Png;
+    int m_width=0;
+    int m_height=0;
+    bool m_enabled=false;
+    bool m_created=false;
+    GLuint m_fbo=0;
+    GLuint m_colour=0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief a multisampled source can only be resolved at its own size, so it goes through here first
+    /// when the capture is scaled
+    //----------------------------------------------------------------------------------------------------------------------
+    GLuint m_resolveFbo=0;
+    GLuint m_resolveColour=0;
+    int m_resolveWidth=0;
+    int m_resolveHeight=0;
+    uint64_t m_frame=0;
+    uint64_t m_captured=0;
+    std::atomic<uint64_t> m_written{0};
+    uint64_t m_dropped=0;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<uint32_t> m_queue;
+    bool m_running=false;
+    std::thread m_thread;
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef FRAMELATENCY_H_
+#define FRAMELATENCY_H_
+#include <cstddef>
+#include <cstdint>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file FrameLatency.h
+/// @brief a rolling window of per frame times, such as input to present latency
+/// @class FrameLatency
+/// @brief add() is cheap enough to call every frame and keeps the last Window samples. latest() and max()
+/// are kept as they arrive, summary() sorts a copy of the window for the median and p99. Not thread safe,
+/// each instance belongs to the thread adding to it.
+//----------------------------------------------------------------------------------------------------------------------
+
+class FrameLatency
+{
+  public:
+    static constexpr size_t Window = 512;
+    struct Summary
+    {
+      /// samples ever added, the percentiles only cover the last Window of them
+      uint64_t samples=0;
+      double median=0.0;
+      double p99=0.0;
+      double max=0.0;
+    };
+    void add(double _ms);
+    double latest() const { return m_latest; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the largest sample ever added
+    //----------------------------------------------------------------------------------------------------------------------
+    double max() const { return m_max; }
+    uint64_t samples() const { return m_samples; }
+    Summary summary() const;
+
+  private:
+    double m_window[Window];
+    uint64_t m_samples=0;
+    double m_latest=0.0;
+    double m_max=0.0;
+};
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef FRAMEPROFILER_H_
+#define FRAMEPROFILER_H_
+#include <ngl/Types.h>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file FrameProfiler.h
+/// @brief CPU and GPU time of each stage of a frame
+/// @class FrameProfiler
+/// @brief mark() closes a stage by reading the CPU clock and issuing a GL_TIMESTAMP query, so the stages of
+/// a frame are the gaps between consecutive marks. The queries rotate through Latency sets and a set is
+/// only read when the frame that reuses it begins, by which point the GPU has normally finished it. A
+/// set whose results are not available yet is dropped rather than waited for. Complete samples can be
+/// appended to a CSV or JSON lines log that rolls over after LogRows rows. When disabled the only cost
+/// is the enabled() check.
+//----------------------------------------------------------------------------------------------------------------------
+
+class FrameProfiler
+{
+  public:
+    enum Stage : uint32_t { Clear, Prepare, Upload, Draw, StageCount };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief frames in flight before a query set is reused
+    //----------------------------------------------------------------------------------------------------------------------
+    static constexpr uint32_t Latency = 3;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief rows written before the log moves to <path>.1 and starts again
+    //----------------------------------------------------------------------------------------------------------------------
+    static constexpr uint32_t LogRows = 10000;
+    struct Sample
+    {
+      uint64_t frame=0;
+      double cpuMs[StageCount]={0.0, 0.0, 0.0, 0.0};
+      double gpuMs[StageCount]={0.0, 0.0, 0.0, 0.0};
+      double cpuTotalMs=0.0;
+      double gpuTotalMs=0.0;
+      uint32_t drawCalls=0;
+      uint64_t triangles=0;
+    };
+    FrameProfiler()=default;
+    FrameProfiler(const FrameProfiler &)=delete;
+    FrameProfiler &operator=(const FrameProfiler &)=delete;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief dtor deletes the queries, the context they were made in must be current
+    //----------------------------------------------------------------------------------------------------------------------
+    ~FrameProfiler();
+    static const char *stageName(Stage _stage);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief start or stop profiling, the queries are created on first use so a context must be current
+    //----------------------------------------------------------------------------------------------------------------------
+    void setEnabled(bool _enabled);
+    bool enabled() const { return m_enabled; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief collect the oldest query set and open the first stage of _frame
+    //----------------------------------------------------------------------------------------------------------------------
+    void beginFrame(uint64_t _frame);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief close _stage, the stages must be marked in order
+    //----------------------------------------------------------------------------------------------------------------------
+    void mark(Stage _stage);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief attach the frame's counters to its sample
+    //----------------------------------------------------------------------------------------------------------------------
+    void endFrame(uint32_t _drawCalls, uint64_t _triangles);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the newest complete sample, Latency-1 frames behind the one being drawn
+    //----------------------------------------------------------------------------------------------------------------------
+    const Sample &latest() const { return m_latest; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief sets whose GPU results were not ready when they had to be reused
+    //----------------------------------------------------------------------------------------------------------------------
+    uint64_t dropped() const { return m_dropped; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief append every complete sample to _path, .csv gives CSV else JSON lines. Enables profiling.
+    /// @returns false if the file could not be opened
+    //----------------------------------------------------------------------------------------------------------------------
+    bool startLog(const std::string &_path);
+    void stopLog();
+    bool logging() const { return m_log.is_open(); }
+
+  private:
+    using Clock = std::chrono::steady_clock;
+    struct Slot
+    {
+      GLuint queries[StageCount+1];
+      Sample sample;
+      bool pending=false;
+    };
+    void collect(Slot &_slot);
+    void write(const Sample &_sample);
+    bool openLog();
+
+    Slot m_slots[Latency];
+    Slot *m_current=nullptr;
+    Clock::time_point m_stageStart;
+    uint32_t m_nextStage=0;
+    bool m_created=false;
+    bool m_enabled=false;
+    Sample m_latest;
+    uint64_t m_dropped=0;
+    std::string m_logPath;
+    bool m_csv=false;
+    uint32_t m_logRows=0;
+    std::ofstream m_log;
+};
+
+#endif
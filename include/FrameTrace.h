@@ -0,0 +1,89 @@
+#ifndef FRAMETRACE_H_
+#define FRAMETRACE_H_
+#include <ngl/Mat4.h>
+#include <ngl/Vec4.h>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file FrameTrace.h
+/// @brief opt-in per cell trace of the transforms and colours sent to the GPU
+/// @class FrameTrace
+/// @brief records are pushed by the render loop into a lock free single producer / single consumer
+/// ring buffer and a background thread drains them to disk as JSON lines (or raw binary records if
+/// the file name ends in .bin). When disabled the only cost is the enabled() check.
+//----------------------------------------------------------------------------------------------------------------------
+
+class FrameTrace
+{
+  public:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief a single traced draw, written as is in binary mode
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Record
+    {
+      uint64_t frame;
+      uint32_t cell;
+      float mvp[16];
+      float colour[4];
+    };
+    FrameTrace()=default;
+    FrameTrace(const FrameTrace &)=delete;
+    FrameTrace &operator=(const FrameTrace &)=delete;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief dtor stops the drain thread and flushes anything left in the ring
+    //----------------------------------------------------------------------------------------------------------------------
+    ~FrameTrace();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief open the trace file and start the drain thread
+    /// @param [in] _path the file to write, .bin gives binary records else JSON lines
+    /// @param [in] _capacity number of records the ring can hold, rounded up to a power of 2
+    /// @returns false if the file could not be opened
+    //----------------------------------------------------------------------------------------------------------------------
+    bool start(const std::string &_path, size_t _capacity=1<<16);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief stop tracing, drain the ring and close the file
+    //----------------------------------------------------------------------------------------------------------------------
+    void stop();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief check this before building any trace data so a disabled trace costs nothing
+    //----------------------------------------------------------------------------------------------------------------------
+    bool enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief push a record from the render thread, never blocks, drops the record if the ring is full
+    //----------------------------------------------------------------------------------------------------------------------
+    void record(uint64_t _frame, uint32_t _cell, const ngl::Mat4 &_mvp, const ngl::Vec4 &_colour);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the number of records lost because the drain thread fell behind
+    //----------------------------------------------------------------------------------------------------------------------
+    uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+  private:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief body of the drain thread
+    //----------------------------------------------------------------------------------------------------------------------
+    void drain();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief write everything currently in the ring, returns the number of records written
+    //----------------------------------------------------------------------------------------------------------------------
+    size_t flush();
+    void write(const Record &_r);
+
+    std::vector<Record> m_ring;
+    size_t m_mask=0;
+    /// written only by the producer
+    std::atomic<size_t> m_head{0};
+    /// written only by the drain thread
+    std::atomic<size_t> m_tail{0};
+    std::atomic<bool> m_enabled{false};
+    std::atomic<bool> m_running{false};
+    std::atomic<uint64_t> m_dropped{0};
+    bool m_binary=false;
+    std::ofstream m_file;
+    std::thread m_thread;
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef FRUSTUM_H_
+#define FRUSTUM_H_
+#include <ngl/Mat4.h>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file Frustum.h
+/// @brief view frustum planes used to cull the grid
+/// @class Frustum
+/// @brief the six planes are pulled straight out of a clip matrix (Gribb / Hartmann) so they are in
+/// whatever space the matrix transforms from, for project*view*mouseRotation that is grid space
+//----------------------------------------------------------------------------------------------------------------------
+
+class Frustum
+{
+  public:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief result of a bounds test
+    //----------------------------------------------------------------------------------------------------------------------
+    enum class Result { Outside, Intersect, Inside };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief extract the planes from _clip
+    //----------------------------------------------------------------------------------------------------------------------
+    explicit Frustum(const ngl::Mat4 &_clip);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief test an axis aligned box
+    //----------------------------------------------------------------------------------------------------------------------
+    Result test(const float *_min, const float *_max) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief true unless the sphere is completely outside one of the planes
+    //----------------------------------------------------------------------------------------------------------------------
+    bool sphereVisible(float _x, float _y, float _z, float _radius) const
+    {
+      for(const float *p : m_planes)
+      {
+        if(p[0]*_x+p[1]*_y+p[2]*_z+p[3] < -_radius)
+        {
+          return false;
+        }
+      }
+      return true;
+    }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the planes as (a, b, c, d) with a unit normal pointing into the frustum
+    //----------------------------------------------------------------------------------------------------------------------
+    const float *planes() const { return &m_planes[0][0]; }
+
+  private:
+    float m_planes[6][4];
+};
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef GRIDCONFIG_H_
+#define GRIDCONFIG_H_
+#include <cstddef>
+#include <cstdint>
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @file GridConfig.h
+/// @brief the layout of the teapot grid, cellsX by cellsZ cells on the y=0 plane centred on the origin.
+/// Cells are addressed by integer index (iz*cellsX+ix) and placed at origin+index*step so large grids
+/// do not accumulate rounding error
+//----------------------------------------------------------------------------------------------------------------------
+struct GridConfig
+{
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief number of cells along x
+  //----------------------------------------------------------------------------------------------------------------------
+  uint32_t cellsX=80;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief number of cells along z
+  //----------------------------------------------------------------------------------------------------------------------
+  uint32_t cellsZ=80;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief distance between neighbouring cells
+  //----------------------------------------------------------------------------------------------------------------------
+  float step=0.5f;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief uniform scale applied to every cell
+  //----------------------------------------------------------------------------------------------------------------------
+  float scale=0.2f;
+
+  size_t cellCount() const { return static_cast<size_t>(cellsX)*cellsZ; }
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief position of the first cell, chosen so the grid is centred on the origin
+  //----------------------------------------------------------------------------------------------------------------------
+  float originX() const { return -0.5f*step*cellsX; }
+  float originZ() const { return -0.5f*step*cellsZ; }
+  float cellX(uint32_t _ix) const { return originX()+_ix*step; }
+  float cellZ(uint32_t _iz) const { return originZ()+_iz*step; }
+};
+
+inline bool operator==(const GridConfig &_a, const GridConfig &_b)
+{
+  return _a.cellsX == _b.cellsX && _a.cellsZ == _b.cellsZ && _a.step == _b.step && _a.scale == _b.scale;
+}
+
+inline bool operator!=(const GridConfig &_a, const GridConfig &_b)
+{
+  return !(_a == _b);
+}
+
+#endif
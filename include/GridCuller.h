@@ -0,0 +1,100 @@
+#ifndef GRIDCULLER_H_
+#define GRIDCULLER_H_
+#include "GridModel.h"
+#include "FrameArena.h"
+#include "Frustum.h"
+#include "GridLod.h"
+#include "JobSystem.h"
+#include <cstdint>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file GridCuller.h
+/// @brief CPU view frustum culling of the grid
+/// @class GridCuller
+/// @brief walks the GridModel tile quadtree rejecting or accepting whole blocks of tiles, then tests
+/// the cells of tiles crossing the frustum in parallel. The surviving cells are written as a compacted
+/// list of indirect draw commands, one per run of consecutive visible cells, using baseInstance to
+/// index the static instance buffer so no per cell data is copied. Runs are also split where the level
+/// of detail changes and the commands are bucketed per level, one multi draw each. The visible tile
+/// list and the per tile slices are frame scratch taken from the renderer's FrameArena.
+//----------------------------------------------------------------------------------------------------------------------
+
+class GridCuller
+{
+  public:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief same layout as the GL DrawArraysIndirectCommand
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Command
+    {
+      uint32_t count;
+      uint32_t instanceCount;
+      uint32_t first;
+      uint32_t baseInstance;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief counters for the last cull
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Stats
+    {
+      uint32_t visible=0;
+      uint32_t culled=0;
+      uint32_t tilesVisible=0;
+      uint32_t tilesCulled=0;
+      /// visible cells drawn at each level of detail
+      uint32_t levels[GridLod::MaxLevels]={0, 0, 0, 0};
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief cull every cell of _model against the frustum of _clip and pick its level of detail
+    /// @param [in] _model the grid, must be up to date
+    /// @param [in] _clip project*view*mouseRotation
+    /// @param [in] _lod the level chain and camera, its vertex counts are written into the commands
+    /// @param [in] _jobs pool used for the per cell tests
+    /// @param [in] _arena frame scratch, must not be reset before the cull returns
+    /// @param [in] _frustum false to keep every cell and only bucket by level
+    //----------------------------------------------------------------------------------------------------------------------
+    void cull(const GridModel &_model, const ngl::Mat4 &_clip, const GridLod &_lod, JobSystem &_jobs, FrameArena &_arena, bool _frustum=true);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the commands drawing _level, empty past the level count of the last cull
+    //----------------------------------------------------------------------------------------------------------------------
+    const std::vector<Command> &commands(uint32_t _level=0) const { return m_commands[_level]; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief every level's commands, GridLod::MaxLevels lists
+    //----------------------------------------------------------------------------------------------------------------------
+    const std::vector<Command> *levels() const { return m_commands; }
+    const Stats &stats() const { return m_stats; }
+
+  private:
+    struct VisibleTile
+    {
+      uint32_t tile;
+      bool inside;
+    };
+    void gatherTiles(const GridModel &_model, const Frustum &_frustum, uint32_t _node, bool _inside);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief write the runs of visible cells of one tile into its slice of m_tileCommands
+    //----------------------------------------------------------------------------------------------------------------------
+    void cullTile(const GridModel &_model, const Frustum &_frustum, const GridLod &_lod, const VisibleTile &_visible);
+
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the tiles gatherTiles kept, room for every tile, only valid during cull
+    //----------------------------------------------------------------------------------------------------------------------
+    VisibleTile *m_visibleTiles=nullptr;
+    uint32_t m_visibleCount=0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief per tile slices big enough for the worst case of alternating visible cells, or of a level
+    /// change at every cell with more than one level, and the level each command draws, only valid during cull
+    //----------------------------------------------------------------------------------------------------------------------
+    Command *m_tileCommands=nullptr;
+    uint8_t *m_tileCommandLevels=nullptr;
+    uint32_t *m_tileOffsets=nullptr;
+    uint32_t *m_tileCounts=nullptr;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief level each cell was drawn at last time it was visible, in tile order, for the hysteresis
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<uint8_t> m_cellLevels;
+    std::vector<Command> m_commands[GridLod::MaxLevels];
+    Stats m_stats;
+};
+
+#endif
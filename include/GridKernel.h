@@ -0,0 +1,53 @@
+#ifndef GRIDKERNEL_H_
+#define GRIDKERNEL_H_
+#include "GridConfig.h"
+#include "AlignedAllocator.h"
+#include <ngl/Mat4.h>
+#include <ngl/Vec4.h>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file GridKernel.h
+/// @brief batch kernels filling the per cell matrices for a range of grid cells. Every cell is a
+/// translate*scale so prefix*model only needs the translation column computing per cell, which the
+/// SSE path does with one multiply-add per column. Define GRID_KERNEL_SCALAR to force the portable
+/// fallback.
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace GridKernel
+{
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief alignment of the matrix arrays, enough for aligned SSE stores of each column
+  //----------------------------------------------------------------------------------------------------------------------
+  constexpr size_t Alignment = 16;
+  typedef std::vector<ngl::Mat4, AlignedAllocator<ngl::Mat4, Alignment>> MatrixArray;
+  typedef std::vector<ngl::Vec4, AlignedAllocator<ngl::Vec4, Alignment>> ColourArray;
+
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief fill _out[0.._end-_begin) with _prefix*model for cells _begin to _end
+  /// @param [in] _grid the grid layout
+  /// @param [in] _prefix matrix applied on the left of every model matrix, identity gives the model matrices
+  /// @param [in] _begin first cell index
+  /// @param [in] _end one past the last cell index
+  /// @param [out] _out matrices, must be Alignment aligned
+  //----------------------------------------------------------------------------------------------------------------------
+  void computeMatrices(const GridConfig &_grid, const ngl::Mat4 &_prefix, size_t _begin, size_t _end, ngl::Mat4 *_out);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the portable version of computeMatrices, also used to check the SIMD path
+  //----------------------------------------------------------------------------------------------------------------------
+  void computeMatricesScalar(const GridConfig &_grid, const ngl::Mat4 &_prefix, size_t _begin, size_t _end, ngl::Mat4 *_out);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief fill _out[0.._end-_begin) with the normalized (z,z,x,1) colour of cells _begin to _end
+  //----------------------------------------------------------------------------------------------------------------------
+  void computeColours(const GridConfig &_grid, size_t _begin, size_t _end, ngl::Vec4 *_out);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief compare computeMatrices against ngl::Transformation for every cell of _grid
+  /// @returns the largest absolute difference of any matrix element
+  //----------------------------------------------------------------------------------------------------------------------
+  float verify(const GridConfig &_grid, const ngl::Mat4 &_prefix);
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief name of the path computeMatrices uses in this build
+  //----------------------------------------------------------------------------------------------------------------------
+  const char *name();
+}
+
+#endif
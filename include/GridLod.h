@@ -0,0 +1,76 @@
+#ifndef GRIDLOD_H_
+#define GRIDLOD_H_
+#include <cstdint>
+#include <string>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file GridLod.h
+/// @brief distance based level of detail for the grid primitive
+/// @class GridLod
+/// @brief a chain of VAOPrimitives meshes for one primitive, finest first, each used down to a projected
+/// size in pixels. The level of a cell only moves once its size is past the boundary by the hysteresis
+/// fraction so cells sitting on a boundary do not pop back and forth as the camera moves.
+//----------------------------------------------------------------------------------------------------------------------
+
+class GridLod
+{
+  public:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief most levels a chain can hold, the per cell level is stored in a byte
+    //----------------------------------------------------------------------------------------------------------------------
+    static constexpr uint32_t MaxLevels = 4;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief one mesh of the chain
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Level
+    {
+      /// VAOPrimitives name
+      std::string name;
+      /// smallest projected cell diameter in pixels this level is used for, 0 for the last
+      float minPixels;
+      /// vertices drawn per instance
+      uint32_t vertexCount;
+      /// scale applied to the mesh so coarse stand ins match the bounds of the finest mesh
+      float scale[3];
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief append a coarser level, ignored once MaxLevels are registered
+    //----------------------------------------------------------------------------------------------------------------------
+    void addLevel(const std::string &_name, float _minPixels, uint32_t _vertexCount,
+                  float _sx=1.0f, float _sy=1.0f, float _sz=1.0f);
+    const Level &level(uint32_t _level) const { return m_levels[_level]; }
+    const std::vector<Level> &levels() const { return m_levels; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief levels in use, 1 (the finest) while disabled
+    //----------------------------------------------------------------------------------------------------------------------
+    uint32_t levelCount() const { return m_enabled ? static_cast<uint32_t>(m_levels.size()) : 1; }
+    void setEnabled(bool _enabled) { m_enabled=_enabled; }
+    bool enabled() const { return m_enabled; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief fraction of a boundary a cell must pass before changing level
+    //----------------------------------------------------------------------------------------------------------------------
+    void setHysteresis(float _fraction) { m_hysteresis=_fraction; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief camera for this frame
+    /// @param [in] _eye eye position in grid space
+    /// @param [in] _pixelScale pixels covered by a unit size at unit distance, viewport height/2 * projection[1][1]
+    //----------------------------------------------------------------------------------------------------------------------
+    void setCamera(const float *_eye, float _pixelScale);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief projected diameter in pixels of a sphere at (_x, _y, _z)
+    //----------------------------------------------------------------------------------------------------------------------
+    float pixels(float _x, float _y, float _z, float _radius) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the level for a cell of _pixels size that used _current last frame
+    //----------------------------------------------------------------------------------------------------------------------
+    uint32_t select(float _pixels, uint32_t _current) const;
+
+  private:
+    std::vector<Level> m_levels;
+    bool m_enabled=true;
+    float m_hysteresis=0.15f;
+    float m_eye[3]={0.0f, 0.0f, 0.0f};
+    float m_pixelScale=1.0f;
+};
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef GRIDMODEL_H_
+#define GRIDMODEL_H_
+#include "GridKernel.h"
+#include "JobSystem.h"
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file GridModel.h
+/// @brief the per cell model matrices and colours of the grid
+/// @class GridModel
+/// @brief the cells only depend on the GridConfig, not on the camera or mouse, so they are built once
+/// into contiguous structure of arrays storage and only rebuilt when the config changes. The grid is
+/// split into square tiles and stored tile by tile so each tile is one contiguous slice that can be
+/// built, copied and culled independently. A quadtree over the tiles lets the culler reject whole
+/// blocks of tiles with one test.
+//----------------------------------------------------------------------------------------------------------------------
+
+class GridModel
+{
+  public:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief cells along each side of a tile, edge tiles may be smaller
+    //----------------------------------------------------------------------------------------------------------------------
+    static constexpr uint32_t TileSize = 32;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief half size of the local bounds of the primitive drawn in each cell, conservative for the NGL teapot
+    //----------------------------------------------------------------------------------------------------------------------
+    static constexpr float CellExtent = 2.0f;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief a w by h block of cells starting at cell (ix, iz), stored from index first in tile row major order
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Tile
+    {
+      uint32_t ix;
+      uint32_t iz;
+      uint32_t w;
+      uint32_t h;
+      uint32_t first;
+      /// grid space bounds of every cell in the tile
+      float min[3];
+      float max[3];
+      uint32_t count() const { return w*h; }
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief quadtree node over a block of tiles, leaves hold a single tile
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Node
+    {
+      float min[3];
+      float max[3];
+      /// index of the first of childCount contiguous children
+      uint32_t firstChild;
+      uint32_t childCount;
+      /// the tile of a leaf node
+      uint32_t tile;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief change the layout, the cells are rebuilt on the next update if it differs from the current one
+    //----------------------------------------------------------------------------------------------------------------------
+    void setConfig(const GridConfig &_config);
+    const GridConfig &config() const { return m_config; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief force a rebuild on the next update, used by the benchmark to time the build
+    //----------------------------------------------------------------------------------------------------------------------
+    void invalidate() { m_dirty=true; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief rebuild the cells if the config has changed, one tile per task on _jobs
+    /// @returns true if the cells were rebuilt so any GPU copy needs uploading again
+    //----------------------------------------------------------------------------------------------------------------------
+    bool update(JobSystem &_jobs);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief true if the cells and quadtree match the config
+    //----------------------------------------------------------------------------------------------------------------------
+    bool built() const { return !m_dirty; }
+    size_t size() const { return m_models.size(); }
+    const std::vector<Tile> &tiles() const { return m_tiles; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the tile quadtree, nodes()[0] is the root, empty for an empty grid
+    //----------------------------------------------------------------------------------------------------------------------
+    const std::vector<Node> &nodes() const { return m_nodes; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief radius of a bounding sphere around the centre of each cell
+    //----------------------------------------------------------------------------------------------------------------------
+    float cellRadius() const { return CellExtent*m_config.scale; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the grid index (iz*cellsX+ix) of the _local'th cell stored in _tile
+    //----------------------------------------------------------------------------------------------------------------------
+    uint32_t cellIndex(const Tile &_tile, uint32_t _local) const
+    {
+      return (_tile.iz+_local/_tile.w)*m_config.cellsX+_tile.ix+_local%_tile.w;
+    }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief model matrix of each cell (position and scale) in tile order
+    //----------------------------------------------------------------------------------------------------------------------
+    const GridKernel::MatrixArray &models() const { return m_models; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief colour of each cell, same order as models()
+    //----------------------------------------------------------------------------------------------------------------------
+    const GridKernel::ColourArray &colours() const { return m_colours; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief fill _out (tile order) with _prefix*model for every cell of _tile
+    //----------------------------------------------------------------------------------------------------------------------
+    void computeTile(const Tile &_tile, const ngl::Mat4 &_prefix, ngl::Mat4 *_out) const;
+
+  private:
+    void rebuild(JobSystem &_jobs);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief build the subtree covering tiles [_tx0, _tx1) x [_tz0, _tz1) into m_nodes[_slot]
+    //----------------------------------------------------------------------------------------------------------------------
+    void buildNode(uint32_t _slot, uint32_t _tx0, uint32_t _tz0, uint32_t _tx1, uint32_t _tz1);
+    GridConfig m_config;
+    bool m_dirty=true;
+    std::vector<Tile> m_tiles;
+    std::vector<Node> m_nodes;
+    uint32_t m_tilesX=0;
+    GridKernel::MatrixArray m_models;
+    GridKernel::ColourArray m_colours;
+};
+
+#endif
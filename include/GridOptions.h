@@ -0,0 +1,83 @@
+#ifndef GRIDOPTIONS_H_
+#define GRIDOPTIONS_H_
+#include "GridConfig.h"
+#include <QCommandLineParser>
+#include <cstddef>
+#include <string>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file GridOptions.h
+/// @brief the command line options describing the grid shown by the app
+/// @class GridOptions
+/// @brief adds --cells, --cells-x, --cells-z, --step, --scale, --far, --threads, --procedural, the streaming and
+/// the --capture and --render-thread options to a parser and builds a GridConfig from them
+//----------------------------------------------------------------------------------------------------------------------
+
+class GridOptions
+{
+  public:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ctor registers the options with _parser, it must outlive this object
+    //----------------------------------------------------------------------------------------------------------------------
+    explicit GridOptions(QCommandLineParser &_parser);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the grid described by the parsed command line, unset options keep the GridConfig defaults
+    //----------------------------------------------------------------------------------------------------------------------
+    GridConfig config() const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief false, after reporting why, if --step, --scale or --far is not a positive number, config() and
+    /// farPlane() would keep the default for it
+    //----------------------------------------------------------------------------------------------------------------------
+    bool valid() const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief distance to the far clipping plane of --far, 0 to keep the GridRenderer default
+    //----------------------------------------------------------------------------------------------------------------------
+    float farPlane() const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief threads used to prepare each frame, 0 (the default) for one per core
+    //----------------------------------------------------------------------------------------------------------------------
+    unsigned int threads() const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief start in the procedural draw mode, for grids too large to store per cell
+    //----------------------------------------------------------------------------------------------------------------------
+    bool procedural() const { return m_parser.isSet(m_procedural); }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief start in the streamed draw mode, an unbounded grid built in tiles around the camera
+    //----------------------------------------------------------------------------------------------------------------------
+    bool streamed() const { return m_parser.isSet(m_streamed); }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief bytes of --tile-budget, 0 to keep the TileStreamer default
+    //----------------------------------------------------------------------------------------------------------------------
+    size_t tileBudget() const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief record frames from launch into this directory, empty if --capture was not given
+    //----------------------------------------------------------------------------------------------------------------------
+    std::string captureDirectory() const { return m_parser.value(m_capture).toStdString(); }
+    bool captureRaw() const { return m_parser.isSet(m_captureRaw); }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the WxH of --capture-size, 0 x 0 to capture at the window size
+    //----------------------------------------------------------------------------------------------------------------------
+    void captureSize(int &o_width, int &o_height) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief draw on a render thread rather than the GUI thread
+    //----------------------------------------------------------------------------------------------------------------------
+    bool renderThread() const { return m_parser.isSet(m_renderThread); }
+
+  private:
+    QCommandLineParser &m_parser;
+    QCommandLineOption m_cells;
+    QCommandLineOption m_cellsX;
+    QCommandLineOption m_cellsZ;
+    QCommandLineOption m_step;
+    QCommandLineOption m_scale;
+    QCommandLineOption m_far;
+    QCommandLineOption m_threads;
+    QCommandLineOption m_procedural;
+    QCommandLineOption m_streamed;
+    QCommandLineOption m_tileBudget;
+    QCommandLineOption m_capture;
+    QCommandLineOption m_captureSize;
+    QCommandLineOption m_captureRaw;
+    QCommandLineOption m_renderThread;
+};
+
+#endif
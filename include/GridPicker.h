@@ -0,0 +1,102 @@
+#ifndef GRIDPICKER_H_
+#define GRIDPICKER_H_
+#include "GridModel.h"
+#include <ngl/Mat4.h>
+#include <cstdint>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file GridPicker.h
+/// @brief finds the grid cell under a pixel without touching the GPU
+/// @class GridPicker
+/// @brief a pixel is unprojected into a grid space ray. Every cell's bounding sphere is centred on the
+/// y=0 plane, so only the part of the ray inside the slab |y| <= cell radius can hit one. Where that
+/// part crosses the plane gives the cell analytically. The spheres of the cells along the rest of its
+/// footprint are then tested front to back to find the nearest cell actually hit, usually the one under
+/// the plane hit or a neighbour standing in front of it. With a built GridModel the GridModel quadtree
+/// is walked nearest node first, so only tiles the ray passes through are looked at. Without one (the
+/// procedural and streamed modes) the footprint is walked directly. Either way a pick tests a few dozen
+/// spheres, whatever the grid size.
+//----------------------------------------------------------------------------------------------------------------------
+
+class GridPicker
+{
+  public:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief a grid space ray, the direction is unit length
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Ray
+    {
+      float origin[3];
+      float direction[3];
+    };
+    struct Hit
+    {
+      bool valid=false;
+      //----------------------------------------------------------------------------------------------------------------------
+      /// @brief the picked cell, ix and iz can be any value on the unbounded grid where cell is not set
+      //----------------------------------------------------------------------------------------------------------------------
+      int32_t ix=0;
+      int32_t iz=0;
+      uint32_t cell=0;
+      //----------------------------------------------------------------------------------------------------------------------
+      /// @brief the cell's position and where the ray enters its bounding sphere, in grid space
+      //----------------------------------------------------------------------------------------------------------------------
+      float centre[3]={0.0f, 0.0f, 0.0f};
+      float point[3]={0.0f, 0.0f, 0.0f};
+      float distance=0.0f;
+      //----------------------------------------------------------------------------------------------------------------------
+      /// @brief bounding spheres tested and the time the pick took
+      //----------------------------------------------------------------------------------------------------------------------
+      uint32_t tested=0;
+      double micros=0.0;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the ray through the centre of pixel (_x, _y), measured from the top left
+    /// @param [in] _inverseClip the inverse of project*view*mouseRotation
+    //----------------------------------------------------------------------------------------------------------------------
+    static Ray unproject(float _x, float _y, int _width, int _height, const ngl::Mat4 &_inverseClip);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief pick from a built model using its quadtree
+    //----------------------------------------------------------------------------------------------------------------------
+    static Hit pick(const GridModel &_model, const Ray &_ray);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief pick from the layout alone, for grids with nothing stored per cell
+    //----------------------------------------------------------------------------------------------------------------------
+    static Hit pick(const GridConfig &_grid, const Ray &_ray);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief pick from the unbounded grid of the streamed mode, cell (ix, iz) at (ix*_step, 0, iz*_step)
+    //----------------------------------------------------------------------------------------------------------------------
+    static Hit pickUnbounded(float _step, float _scale, const Ray &_ray);
+
+  private:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief where the cells are and the inclusive range of them that exists
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Layout
+    {
+      float originX;
+      float originZ;
+      float step;
+      float radius;
+      int32_t minX;
+      int32_t minZ;
+      int32_t maxX;
+      int32_t maxZ;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief clip [io_near, io_far] along _ray to the box, false if nothing is left
+    //----------------------------------------------------------------------------------------------------------------------
+    static bool clip(const Ray &_ray, const float *_min, const float *_max, float &io_near, float &io_far);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the part of _ray that can reach a cell, false if it misses the slab entirely
+    //----------------------------------------------------------------------------------------------------------------------
+    static bool slab(const Ray &_ray, float _radius, float &o_near, float &o_far);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief test the cells under _ray between _near and _far, keeping the nearest hit in io_hit
+    //----------------------------------------------------------------------------------------------------------------------
+    static void walk(const Layout &_layout, const Ray &_ray, float _near, float _far, Hit &io_hit);
+    static void walkNode(const GridModel &_model, const Layout &_layout, const Ray &_ray, uint32_t _node,
+                         float _near, float _far, Hit &io_hit);
+    static void finish(const Ray &_ray, Hit &io_hit);
+};
+
+#endif
@@ -0,0 +1,507 @@
+#ifndef GRIDRENDERER_H_
+#define GRIDRENDERER_H_
+#include "GridModel.h"
+#include "GridCuller.h"
+#include "GridLod.h"
+#include "FrameArena.h"
+#include "GridPicker.h"
+#include "FrameTrace.h"
+#include "FrameProfiler.h"
+#include "JobSystem.h"
+#include "ProgramCache.h"
+#include "RenderQueue.h"
+#include "ShaderProgram.h"
+#include "StreamBuffer.h"
+#include "TileStreamer.h"
+#include "UniformBlock.h"
+#include <ngl/Types.h>
+#include <ngl/Mat4.h>
+#include <ngl/Vec4.h>
+#include <ngl/AbstractVAO.h>
+#include <cstdint>
+#include <map>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file GridRenderer.h
+/// @brief draws the teapot grid into whatever framebuffer is bound, independent of any window so
+/// NGLScene and the offscreen benchmark share the same code
+/// @class GridRenderer
+/// @brief a valid GL context must be current for every method apart from the ctor
+//----------------------------------------------------------------------------------------------------------------------
+
+class GridRenderer
+{
+  public:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the ways the grid can be submitted, toggled at runtime for A/B comparison. Procedural builds
+    /// every cell in the vertex shader from its instance id so no per cell data is stored at all, it
+    /// draws the whole grid without culling or level of detail. Streamed ignores the grid size and draws an
+    /// unbounded grid from the tiles TileStreamer keeps around the camera, culled and given a level of
+    /// detail per tile. Mixed gives every cell one of several meshes, shaders and materials and draws the
+    /// visible cells through a RenderQueue, culled on the CPU without a level of detail
+    //----------------------------------------------------------------------------------------------------------------------
+    enum class DrawMode { PerDraw, Instanced, Procedural, Streamed, Mixed };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief how cells outside the view frustum are removed, Gpu only applies to the instanced path and
+    /// falls back to Cpu for per draw. Gpu can also remove occluded cells, see setOcclusion.
+    //----------------------------------------------------------------------------------------------------------------------
+    enum class CullMode { None, Cpu, Gpu };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief counters for the last rendered frame
+    //----------------------------------------------------------------------------------------------------------------------
+    struct FrameStats
+    {
+      uint32_t drawCalls=0;
+      //----------------------------------------------------------------------------------------------------------------------
+      /// @brief cells submitted to the GPU, with Gpu culling this is the count from the previous frame
+      //----------------------------------------------------------------------------------------------------------------------
+      uint32_t instances=0;
+      uint32_t culled=0;
+      uint32_t tilesCulled=0;
+      //----------------------------------------------------------------------------------------------------------------------
+      /// @brief cells in the frustum but hidden behind the last frame's depth, part of culled
+      //----------------------------------------------------------------------------------------------------------------------
+      uint32_t occluded=0;
+      //----------------------------------------------------------------------------------------------------------------------
+      /// @brief cells drawn at each level of detail and the vertices they submit, CPU built commands only
+      //----------------------------------------------------------------------------------------------------------------------
+      uint32_t levels[GridLod::MaxLevels]={0, 0, 0, 0};
+      uint64_t vertices=0;
+      //----------------------------------------------------------------------------------------------------------------------
+      /// @brief glUseProgram calls, only made when the program actually changes
+      //----------------------------------------------------------------------------------------------------------------------
+      uint32_t programBinds=0;
+      //----------------------------------------------------------------------------------------------------------------------
+      /// @brief the Mixed mode's state changes in the order the cells were culled and after sorting, and the
+      /// CPU time of the sort
+      //----------------------------------------------------------------------------------------------------------------------
+      RenderQueue::StateChanges unsortedChanges;
+      RenderQueue::StateChanges sortedChanges;
+      double sortMs=0.0;
+      //----------------------------------------------------------------------------------------------------------------------
+      /// @brief times the frame waited for the GPU to release its stream buffer region, and for how long
+      //----------------------------------------------------------------------------------------------------------------------
+      uint32_t fenceWaits=0;
+      double fenceWaitMs=0.0;
+      //----------------------------------------------------------------------------------------------------------------------
+      /// @brief CPU time spent building the grid and per cell data before any draw was issued
+      //----------------------------------------------------------------------------------------------------------------------
+      double prepareMs=0.0;
+    };
+    GridRenderer()=default;
+    GridRenderer(const GridRenderer &)=delete;
+    GridRenderer &operator=(const GridRenderer &)=delete;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief dtor releases the GL objects, the context used for initialize must be current
+    //----------------------------------------------------------------------------------------------------------------------
+    ~GridRenderer();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief init NGL, build the programs through the ProgramCache and create the buffers, called once we
+    /// have a context
+    //----------------------------------------------------------------------------------------------------------------------
+    void initialize();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief set the viewport and rebuild the projection
+    /// @param [in] _w the width of the framebuffer in pixels
+    /// @param [in] _h the height of the framebuffer in pixels
+    //----------------------------------------------------------------------------------------------------------------------
+    void resize(int _w, int _h);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief distance to the far clipping plane, nothing beyond it is drawn and the streamed grid only
+    /// extends that far. The coarser levels of detail need cells well past the default of 10, with the
+    /// hysteresis a cell of the default grid only leaves the finest level about 135 units away at 720 pixels high
+    //----------------------------------------------------------------------------------------------------------------------
+    void setFarPlane(float _far);
+    float farPlane() const { return m_farPlane; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief clear and draw the grid
+    /// @param [in] _mouseRotation the rotation and translation from the mouse applied to every cell
+    //----------------------------------------------------------------------------------------------------------------------
+    void render(const ngl::Mat4 &_mouseRotation);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief change the grid layout, the per cell data is rebuilt on the next render if it differs
+    //----------------------------------------------------------------------------------------------------------------------
+    void setGrid(const GridConfig &_grid) { m_model.setConfig(_grid); }
+    const GridConfig &grid() const { return m_model.config(); }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief rebuild the per cell data on the next render even if the grid has not changed
+    //----------------------------------------------------------------------------------------------------------------------
+    void invalidateGrid() { m_model.invalidate(); }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief number of threads (including the render thread) used to prepare the frame, 0 for one per core
+    //----------------------------------------------------------------------------------------------------------------------
+    void setThreadCount(unsigned int _threads) { m_jobs.setThreadCount(_threads); }
+    unsigned int threadCount() const { return m_jobs.threadCount(); }
+    void setDrawMode(DrawMode _mode) { m_drawMode=_mode; }
+    DrawMode drawMode() const { return m_drawMode; }
+    void setCullMode(CullMode _mode) { m_cullMode=_mode; }
+    CullMode cullMode() const { return m_cullMode; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief switch hierarchical depth occlusion culling, used by the instanced path with Gpu culling.
+    /// Each frame's depth is reduced into a farthest depth pyramid which the next frame's compute cull
+    /// tests every cell against, so a cell uncovered by a fast camera move can appear a frame late.
+    //----------------------------------------------------------------------------------------------------------------------
+    void setOcclusion(bool _enabled) { m_occlusion=_enabled; m_pyramidValid=false; }
+    bool occlusion() const { return m_occlusion; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief switch the distance based level of detail, the finest mesh is drawn everywhere while off
+    //----------------------------------------------------------------------------------------------------------------------
+    void setLod(bool _enabled) { m_lod.setEnabled(_enabled); }
+    bool lod() const { return m_lod.enabled(); }
+    const FrameStats &stats() const { return m_stats; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief true if the last frame's occlusion test used a depth pyramid drawn from a different view. A
+    /// cell it wrongly hid stays hidden until a frame is drawn with an unchanged view, so the owner should
+    /// draw again even if nothing else changed
+    //----------------------------------------------------------------------------------------------------------------------
+    bool occlusionStale() const { return m_occlusionStale; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief how much per frame scratch the last frame took, the arena only allocates while the peak grows
+    //----------------------------------------------------------------------------------------------------------------------
+    const FrameArena::Stats &arenaStats() const { return m_arena.stats(); }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief how initialize built the programs
+    //----------------------------------------------------------------------------------------------------------------------
+    const ProgramCache::Stats &programStats() const { return m_programStats; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief replace the model matrix and colour of one cell (grid index iz*cellsX+ix) in the procedural
+    /// mode, meant for a sparse set of cells that differ from the regular layout
+    //----------------------------------------------------------------------------------------------------------------------
+    void setCellOverride(uint32_t _cell, const ngl::Mat4 &_model, const ngl::Vec4 &_colour);
+    void clearCellOverride(uint32_t _cell);
+    void clearCellOverrides();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the cell under framebuffer pixel (_x, _y), from the top left, for the camera render was last
+    /// given _mouseRotation. Only reads the CPU side grid so no context is needed.
+    //----------------------------------------------------------------------------------------------------------------------
+    GridPicker::Hit pick(float _x, float _y, const ngl::Mat4 &_mouseRotation) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief draw a highlight over the picked cell until cleared, an invalid hit clears it
+    //----------------------------------------------------------------------------------------------------------------------
+    void setHighlight(const GridPicker::Hit &_hit);
+    void clearHighlight() { m_highlight=false; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief memory for the streamed tiles, the resident tiles are dropped and streamed in again
+    //----------------------------------------------------------------------------------------------------------------------
+    void setTileBudget(size_t _bytes) { m_streamer.setBudget(_bytes); }
+    const TileStreamer &streamer() const { return m_streamer; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief opt-in trace of the per cell MVP and colour, not recorded in the procedural or streamed modes
+    //----------------------------------------------------------------------------------------------------------------------
+    FrameTrace &trace() { return m_trace; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief per stage CPU and GPU times, off until enabled or a log is started
+    //----------------------------------------------------------------------------------------------------------------------
+    FrameProfiler &profiler() { return m_profiler; }
+
+  private:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief per frame camera, matches the std140 Camera block in ColourVertex.glsl
+    //----------------------------------------------------------------------------------------------------------------------
+    struct CameraBlock
+    {
+      ngl::Mat4 view;
+      ngl::Mat4 project;
+      ngl::Mat4 mouseRotation;
+      /// project*view*mouseRotation
+      ngl::Mat4 viewProject;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the grid layout for the procedural mode, matches the std140 Grid block in ColourVertex.glsl
+    //----------------------------------------------------------------------------------------------------------------------
+    struct GridBlock
+    {
+      /// x and z of cell 0, step, scale
+      float origin[4];
+      /// cellsX, cellsZ, number of overrides, unused
+      uint32_t cells[4];
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief one entry of the std430 override buffer, sorted by cell so the shader can binary search it
+    //----------------------------------------------------------------------------------------------------------------------
+    struct CellOverride
+    {
+      ngl::Mat4 model;
+      ngl::Vec4 colour;
+      uint32_t cell;
+      uint32_t pad[3];
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief m_cullCommandBuffer, matches the Command block in CullCompute.glsl
+    //----------------------------------------------------------------------------------------------------------------------
+    struct CullCommand
+    {
+      GridCuller::Command draw;
+      GLuint occluded;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief make _program current if it is not already, counting the binds
+    //----------------------------------------------------------------------------------------------------------------------
+    void useProgram(const ShaderProgram &_program);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief use the colour program and bind the VAO of _level with its lodScale
+    /// @returns the bound VAO, to be unbound by the caller
+    //----------------------------------------------------------------------------------------------------------------------
+    ngl::AbstractVAO *bindLevel(uint32_t _level);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief point the instanced attributes of every level of detail VAO at their own vertex buffer bindings
+    /// so the source buffer can be swapped per draw with bindInstanceBuffer
+    //----------------------------------------------------------------------------------------------------------------------
+    void setupInstanceAttributes();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief use _buffer (models then colours from _colourOffset) for the instanced attributes, the VAO must be bound
+    //----------------------------------------------------------------------------------------------------------------------
+    void bindInstanceBuffer(GLuint _buffer, size_t _colourOffset);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief bindInstanceBuffer for the VAO of every level of detail
+    //----------------------------------------------------------------------------------------------------------------------
+    void attachInstanceBuffer(GLuint _buffer, size_t _colourOffset);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief register the level of detail chain for the teapot
+    //----------------------------------------------------------------------------------------------------------------------
+    void createLods();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief create the meshes of the Mixed mode and give their VAOs the sorted instance attribute
+    //----------------------------------------------------------------------------------------------------------------------
+    void createQueueMeshes();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief give m_lod the eye position for this frame
+    //----------------------------------------------------------------------------------------------------------------------
+    void updateLodCamera(const ngl::Mat4 &_mouseRotation);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief copy the cached cells to the instance buffer
+    //----------------------------------------------------------------------------------------------------------------------
+    void uploadInstanceBuffer();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief one draw call per visible cell, each reading its instance attributes through baseInstance,
+    /// kept as the unbatched baseline for the benchmark
+    //----------------------------------------------------------------------------------------------------------------------
+    void drawPerCell();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief draw the whole grid with a single instanced or indirect draw call
+    /// @param _VP project*view*mouse rotation, composed once per frame
+    //----------------------------------------------------------------------------------------------------------------------
+    void drawInstanced(const ngl::Mat4 &_VP);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief pick the shader, mesh and material of every cell, whenever the grid is rebuilt
+    //----------------------------------------------------------------------------------------------------------------------
+    void assignCellStates();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief submit a packet for every cell the culler kept and sort m_queue
+    /// @param _VP project*view*mouse rotation, its bottom row gives each cell's depth
+    //----------------------------------------------------------------------------------------------------------------------
+    void queueCells(const ngl::Mat4 &_VP);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief one instanced draw per batch of m_queue, binding only the state that differs from the last batch
+    //----------------------------------------------------------------------------------------------------------------------
+    void drawQueue();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief one instanced draw of every cell built in the vertex shader
+    //----------------------------------------------------------------------------------------------------------------------
+    void drawProcedural();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief stream the Grid block and bind the overrides for this frame
+    //----------------------------------------------------------------------------------------------------------------------
+    void updateGridBlock();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief copy m_overrides to m_overrideBuffer if they have changed
+    //----------------------------------------------------------------------------------------------------------------------
+    void uploadOverrides();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief update m_streamer around the eye and build m_tileCommands from the tiles in the frustum
+    //----------------------------------------------------------------------------------------------------------------------
+    void streamTiles(const ngl::Mat4 &_mouseRotation, const ngl::Mat4 &_VP);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief copy this frame's finished tiles to m_tileBuffer, reallocating it if the budget has changed
+    //----------------------------------------------------------------------------------------------------------------------
+    void uploadTiles();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief draw m_tileCommands from m_tileBuffer
+    //----------------------------------------------------------------------------------------------------------------------
+    void drawStreamed();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief draw the finest mesh enlarged in the highlight colour over the picked cell
+    //----------------------------------------------------------------------------------------------------------------------
+    void drawHighlight();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief one glMultiDrawArraysIndirect per level of detail, streamed through m_stream
+    /// @param [in] _levels GridLod::MaxLevels command lists, one per level
+    //----------------------------------------------------------------------------------------------------------------------
+    void drawCommands(const std::vector<GridCuller::Command> *_levels);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief record the MVP and colour of every drawn cell to m_trace
+    //----------------------------------------------------------------------------------------------------------------------
+    void traceFrame(const ngl::Mat4 &_VP);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief cull in a compute shader, compacting visible cells into m_culledBuffer and counting them
+    /// in m_cullCommandBuffer
+    //----------------------------------------------------------------------------------------------------------------------
+    void cullOnGpu(const ngl::Mat4 &_VP);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief true if this frame's cull is tested against the depth pyramid and its depth reduced into it
+    //----------------------------------------------------------------------------------------------------------------------
+    bool occlusionActive() const
+    {
+      return m_occlusion && gpuCull() && m_drawMode == DrawMode::Instanced && m_pyramidProgram.valid();
+    }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief true if the Gpu cull mode can run, without a cull program it falls back to the CPU culler
+    //----------------------------------------------------------------------------------------------------------------------
+    bool gpuCull() const { return m_cullMode == CullMode::Gpu && m_cullProgram.valid(); }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief copy the depth of the bound framebuffer and reduce it into m_pyramid for the next frame
+    //----------------------------------------------------------------------------------------------------------------------
+    void buildDepthPyramid(const ngl::Mat4 &_VP);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief true if the draws should come from the m_culler commands this frame, the compute cull has no
+    /// level of detail so the instanced Gpu path always draws the finest mesh
+    //----------------------------------------------------------------------------------------------------------------------
+    bool cpuCommands() const
+    {
+      if(m_drawMode == DrawMode::Procedural || m_drawMode == DrawMode::Streamed)
+      {
+        return false;
+      }
+      if(m_drawMode == DrawMode::Mixed)
+      {
+        return true;
+      }
+      if(gpuCull())
+      {
+        return m_drawMode == DrawMode::PerDraw;
+      }
+      return m_cullMode != CullMode::None || m_lod.levelCount() > 1;
+    }
+
+    DrawMode m_drawMode=DrawMode::Instanced;
+    CullMode m_cullMode=CullMode::Cpu;
+    FrameStats m_stats;
+    ngl::Mat4 m_view;
+    ngl::Mat4 m_project;
+    int m_width=1024;
+    int m_height=720;
+    float m_farPlane=10.0f;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief cached per cell matrices and colours
+    //----------------------------------------------------------------------------------------------------------------------
+    GridModel m_model;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief cache hits, misses and build times from initialize
+    //----------------------------------------------------------------------------------------------------------------------
+    ProgramCache::Stats m_programStats;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the colour shader, every cell is drawn through its instance attributes so the only uniforms
+    /// are the camera block and the level of detail scale
+    //----------------------------------------------------------------------------------------------------------------------
+    ShaderProgram m_colourProgram;
+    Uniform<ngl::Vec3> m_lodScale;
+    Uniform<GLint> m_procedural;
+    UniformBlock<CameraBlock> m_camera;
+    UniformBlock<GridBlock> m_gridBlock;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the procedural mode overrides, kept sorted by cell, and their GPU copy
+    //----------------------------------------------------------------------------------------------------------------------
+    std::map<uint32_t, CellOverride> m_overrides;
+    bool m_overridesDirty=true;
+    GLuint m_overrideBuffer=0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief everything written every frame, the camera block and the indirect commands
+    //----------------------------------------------------------------------------------------------------------------------
+    StreamBuffer m_stream;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the CPU side counterpart, scratch of the cull, the queue and the streamer that only lives for
+    /// one frame, reset at the start of every render
+    //----------------------------------------------------------------------------------------------------------------------
+    FrameArena m_arena;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief worker pool preparing the grid, the render thread takes part in every job
+    //----------------------------------------------------------------------------------------------------------------------
+    JobSystem m_jobs;
+    GridCuller m_culler;
+    GridLod m_lod;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief buffer holding all of the model matrices followed by all of the colours, read as per-instance attributes
+    //----------------------------------------------------------------------------------------------------------------------
+    GLuint m_instanceBuffer=0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief persistent write mapping of m_instanceBuffer
+    //----------------------------------------------------------------------------------------------------------------------
+    char *m_instanceData=nullptr;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief byte offset of the colours in m_instanceBuffer and m_culledBuffer, aligned for SSBO binding
+    //----------------------------------------------------------------------------------------------------------------------
+    size_t m_colourOffset=0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the number of cells stored in m_instanceBuffer
+    //----------------------------------------------------------------------------------------------------------------------
+    GLsizei m_instanceCount=0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief compute culling resources, the output instances, the single indirect command and a
+    /// persistently mapped copy of its counts per frame slot, read a frame late behind each slot's fence
+    /// for the stats. m_cullCounts holds the latest counts whose fence has passed
+    //----------------------------------------------------------------------------------------------------------------------
+    ShaderProgram m_cullProgram;
+    Uniform<ngl::Vec4> m_cullPlanes;
+    Uniform<float> m_cullRadius;
+    Uniform<GLuint> m_cullCount;
+    GLuint m_culledBuffer=0;
+    GLuint m_cullCommandBuffer=0;
+    GLuint m_cullReadback=0;
+    const CullCommand *m_cullReadbackData=nullptr;
+    GLsync m_cullFences[2]={nullptr, nullptr};
+    CullCommand m_cullCounts={ {0, 0, 0, 0}, 0 };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief occlusion culling, a single sampled copy of the depth buffer in a matching format and the
+    /// R32F farthest depth pyramid, level 0 half the framebuffer rounded up to a power of two
+    //----------------------------------------------------------------------------------------------------------------------
+    bool m_occlusion=false;
+    bool m_occlusionStale=false;
+    ShaderProgram m_pyramidProgram;
+    Uniform<GLint> m_pyramidSourceLevel;
+    Uniform<ngl::Mat4> m_cullPyramidVP;
+    Uniform<ngl::Vec4> m_cullPyramidInfo;
+    GLuint m_depthTexture=0;
+    GLuint m_depthFbo=0;
+    GLenum m_depthFormat=GL_NONE;
+    GLuint m_pyramid=0;
+    int m_depthWidth=0;
+    int m_depthHeight=0;
+    GLint m_pyramidLevels=0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief set once m_pyramid holds a frame, with the clip matrix that frame used
+    //----------------------------------------------------------------------------------------------------------------------
+    bool m_pyramidValid=false;
+    ngl::Mat4 m_pyramidVP;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the streamed mode, m_tileBuffer holds capacity() tiles laid out like m_instanceBuffer, a
+    /// tile's cells start at instance slot*TileCells
+    //----------------------------------------------------------------------------------------------------------------------
+    TileStreamer m_streamer;
+    GLuint m_tileBuffer=0;
+    char *m_tileData=nullptr;
+    size_t m_tileColourOffset=0;
+    uint32_t m_tileCapacity=0;
+    std::vector<GridCuller::Command> m_tileCommands[GridLod::MaxLevels];
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the Mixed mode, a flat shaded and a lit variant of the colour program, the meshes and the
+    /// RenderQueue::state of every cell in instance order
+    //----------------------------------------------------------------------------------------------------------------------
+    static constexpr uint32_t QueueShaders = 2;
+    ShaderProgram m_queuePrograms[QueueShaders];
+    Uniform<ngl::Vec4> m_queueTint[QueueShaders];
+    std::vector<ngl::AbstractVAO *> m_queueMeshes;
+    std::vector<uint32_t> m_cellStates;
+    RenderQueue m_queue;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief grid space position of the highlighted cell
+    //----------------------------------------------------------------------------------------------------------------------
+    bool m_highlight=false;
+    float m_highlightCentre[3]={0.0f, 0.0f, 0.0f};
+    FrameTrace m_trace;
+    FrameProfiler m_profiler;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief number of frames drawn, used to tag trace records
+    //----------------------------------------------------------------------------------------------------------------------
+    uint64_t m_frame=0;
+};
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef JOBSYSTEM_H_
+#define JOBSYSTEM_H_
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file JobSystem.h
+/// @brief a small work stealing thread pool used to prepare the grid in parallel
+/// @class JobSystem
+/// @brief each thread has its own task ring, it pops its own work from the back and steals from the
+/// front of the other rings when it runs dry. The calling thread takes part in every parallelFor so a
+/// pool of N threads starts N-1 workers. Tasks are plain function pointer / range pairs stored in
+/// fixed size rings so scheduling a parallelFor never allocates. The workers are only started by the
+/// first parallelFor, so setting the thread count straight after construction costs nothing.
+//----------------------------------------------------------------------------------------------------------------------
+
+class JobSystem
+{
+  public:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ctor only records the thread count, the workers start with the first parallelFor
+    /// @param [in] _threads total threads including the caller, 0 uses std::thread::hardware_concurrency
+    //----------------------------------------------------------------------------------------------------------------------
+    explicit JobSystem(unsigned int _threads=0);
+    JobSystem(const JobSystem &)=delete;
+    JobSystem &operator=(const JobSystem &)=delete;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief dtor joins the workers
+    //----------------------------------------------------------------------------------------------------------------------
+    ~JobSystem();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief stop the current workers if the count changes, the new set starts with the next parallelFor.
+    /// Must not be called during a parallelFor
+    /// @param [in] _threads total threads including the caller, 0 uses std::thread::hardware_concurrency
+    //----------------------------------------------------------------------------------------------------------------------
+    void setThreadCount(unsigned int _threads);
+    unsigned int threadCount() const { return m_threadCount; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief split [_begin, _end) into chunks of at most _grain items and call _func(chunkBegin, chunkEnd)
+    /// for each on the pool, returns once every chunk has run. Only one thread may issue work at a time.
+    //----------------------------------------------------------------------------------------------------------------------
+    template <typename Func>
+    void parallelFor(size_t _begin, size_t _end, size_t _grain, Func &&_func)
+    {
+      typedef typename std::remove_reference<Func>::type Body;
+      run(_begin, _end, _grain,
+          [](void *_body, size_t _b, size_t _e) { (*static_cast<Body *>(_body))(_b, _e); },
+          const_cast<void *>(static_cast<const void *>(&_func)));
+    }
+
+  private:
+    typedef void (*TaskFunction)(void *, size_t, size_t);
+    struct Task
+    {
+      TaskFunction function;
+      void *body;
+      size_t begin;
+      size_t end;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief fixed capacity deque of tasks, the owner works from the back and thieves from the front
+    //----------------------------------------------------------------------------------------------------------------------
+    struct TaskQueue
+    {
+      static constexpr size_t Capacity = 1024;
+      std::mutex mutex;
+      Task tasks[Capacity];
+      size_t head=0;
+      size_t tail=0;
+      bool push(const Task &_task);
+      bool pop(Task &o_task);
+      bool steal(Task &o_task);
+    };
+    void run(size_t _begin, size_t _end, size_t _grain, TaskFunction _function, void *_body);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief take a task from queue _index or steal one from any other queue
+    //----------------------------------------------------------------------------------------------------------------------
+    bool next(size_t _index, Task &o_task);
+    void execute(const Task &_task);
+    void worker(size_t _index);
+    static unsigned int resolve(unsigned int _threads);
+    void start(unsigned int _threads);
+    void stop();
+
+    unsigned int m_threadCount;
+    std::vector<std::unique_ptr<TaskQueue>> m_queues;
+    std::vector<std::thread> m_workers;
+    std::atomic<size_t> m_remaining{0};
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    uint64_t m_generation=0;
+    bool m_stop=false;
+};
+
+#endif
@@ -2,8 +2,15 @@
 #define NGLSCENE_H_
 #include <ngl/Vec3.h>
 #include "WindowParams.h"
+#include "GridRenderer.h"
+#include "RenderScheduler.h"
+#include "FrameCapture.h"
+#include "FrameLatency.h"
+#include "RenderThread.h"
+#include "SceneState.h"
 #include <ngl/Transformation.h> // pos rot and scale
 #include <ngl/Mat4.h>
+#include <chrono>
 // this must be included after NGL includes else we get a clash with gl libs
 #include <QOpenGLWindow>
 //----------------------------------------------------------------------------------------------------------------------
@@ -16,7 +23,9 @@
 /// This is an initial version used for the new NGL6 / Qt 5 demos
 /// @class NGLScene
 /// @brief our main glwindow widget for NGL applications all drawing elements are
-/// put in this file
+/// put in this file. Input only edits m_state, frames are drawn from a copy of it by drawFrame, either in
+/// paintGL or, with setRenderThread, on a RenderThread with a context of its own. Members below are
+/// marked as belonging to the GUI thread or to whichever thread draws.
 //----------------------------------------------------------------------------------------------------------------------
 
 class NGLScene : public QOpenGLWindow
@@ -24,9 +33,10 @@ class NGLScene : public QOpenGLWindow
   public:
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief ctor for our NGL drawing class
-    /// @param [in] parent the parent window to the class
+    /// @param [in] _grid the layout of the grid to draw
+    /// @param [in] _threads threads used to prepare each frame, 0 for one per core
     //----------------------------------------------------------------------------------------------------------------------
-    NGLScene();
+    explicit NGLScene(const GridConfig &_grid=GridConfig(), unsigned int _threads=0);
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief dtor must close down ngl and release OpenGL resources
     //----------------------------------------------------------------------------------------------------------------------
@@ -41,12 +51,39 @@ class NGLScene : public QOpenGLWindow
     //----------------------------------------------------------------------------------------------------------------------
     void paintGL() override;
     //----------------------------------------------------------------------------------------------------------------------
+    /// @brief draws the profiler overlay with QPainter straight onto the window, after the last frame
+    /// has been blitted, so skipped frames still show it
+    //----------------------------------------------------------------------------------------------------------------------
+    void paintOverGL() override;
+    //----------------------------------------------------------------------------------------------------------------------
     /// @brief this is called everytime we resize the window
     //----------------------------------------------------------------------------------------------------------------------
     void resizeGL(int _w, int _h) override;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the renderer, for settings made before the window is shown. After that only the thread
+    /// drawing touches it.
+    //----------------------------------------------------------------------------------------------------------------------
+    GridRenderer &renderer() { return m_renderer; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief draw on a thread of its own so a slow frame never holds up input, call before the window
+    /// is shown. Stays off where the platform can not use OpenGL from a second thread.
+    //----------------------------------------------------------------------------------------------------------------------
+    void setRenderThread(bool _enabled);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief size and format used by recordings, 0 x 0 for the window size
+    //----------------------------------------------------------------------------------------------------------------------
+    void setCaptureSize(int _width, int _height, bool _raw);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief record every frame into _directory until R is pressed, can be called before the window is shown
+    //----------------------------------------------------------------------------------------------------------------------
+    void startCapture(const std::string &_directory);
 
 private:
-
+    using Clock = std::chrono::steady_clock;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief with the render thread on, keeps QOpenGLWindow from creating its own context and painting
+    //----------------------------------------------------------------------------------------------------------------------
+    bool event(QEvent *_event) override;
     //----------------------------------------------------------------------------------------------------------------------
     /// @brief Qt Event called when a key is pressed
     /// @param [in] _event the Qt event to query for size etc
@@ -76,15 +113,112 @@ private:
     /// @param _event the Qt Event structure
     //----------------------------------------------------------------------------------------------------------------------
     void wheelEvent( QWheelEvent *_event) override;
-    /// @brief windows parameters for mouse control etc.
-    WinParams m_win;
-    /// position for our model
-    ngl::Vec3 m_modelPos;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief mark _dirty (RenderScheduler::Dirty flags) as changed and ask for a frame, from Qt unless one
+    /// is pending or from the render thread
+    //----------------------------------------------------------------------------------------------------------------------
+    void requestRender(uint32_t _dirty);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief hand a snapshot of m_state to the render thread, carrying over the changes of any it never took
+    //----------------------------------------------------------------------------------------------------------------------
+    void publish(uint32_t _dirty);
+    void startRenderThread();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief copy the settings made through renderer() into m_state once the window shows
+    //----------------------------------------------------------------------------------------------------------------------
+    void syncState();
+    void recordStall(Clock::time_point _start);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the mouse rotation with the pan and zoom, what the renderer is given
+    //----------------------------------------------------------------------------------------------------------------------
+    static ngl::Mat4 mouseTransform(const SceneState &_state);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief move the cursor to window position (_x, _y), picking the cell under it straight away unless
+    /// the render thread owns the renderer
+    //----------------------------------------------------------------------------------------------------------------------
+    void updatePick(int _x, int _y);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief pick the cell under _state's cursor and move the highlight to it, printing it for a new click
+    /// @returns true if the picked cell changed
+    //----------------------------------------------------------------------------------------------------------------------
+    bool pickCell(const SceneState &_state);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief draw _state into _framebuffer, the body of both paintGL and the render thread
+    /// @param [in] _dirty what changed since the last frame, nothing is drawn for None
+    /// @param [out] o_drawn set if a frame was drawn
+    /// @returns the RenderScheduler::Dirty flags wanting another frame straight away
+    //----------------------------------------------------------------------------------------------------------------------
+    uint32_t drawFrame(const SceneState &_state, uint32_t _dirty, GLuint _framebuffer, bool &o_drawn);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief pass the settings of _state that changed on to the renderer, the profiler, tracing and recording
+    //----------------------------------------------------------------------------------------------------------------------
+    void applyState(const SceneState &_state);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the profiler overlay, drawn over the frame with QPainter
+    //----------------------------------------------------------------------------------------------------------------------
+    void drawOverlay(QPaintDevice *_device, const SceneState &_state);
+    bool beginCapture(const std::string &_directory);
 
-    ngl::Mat4 m_view;
-    ngl::Mat4 m_project;
-    void loadMatrixToShader(const ngl::Mat4 &_tx, const ngl::Vec4 &_colour);
+    // GUI thread
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief everything input has changed, including the mouse state and model position
+    //----------------------------------------------------------------------------------------------------------------------
+    SceneState m_state;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief coalesces input into at most one frame per update and skips frames with nothing changed
+    //----------------------------------------------------------------------------------------------------------------------
+    RenderScheduler m_scheduler;
+    bool m_threaded=false;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief snapshots published and the changes made since the render thread last took one
+    //----------------------------------------------------------------------------------------------------------------------
+    uint64_t m_published=0;
+    uint32_t m_untaken=RenderScheduler::None;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief when the first input not yet drawn arrived, and while paintGL draws the one its frame answers
+    //----------------------------------------------------------------------------------------------------------------------
+    bool m_inputPending=false;
+    Clock::time_point m_inputStart;
+    bool m_presenting=false;
+    Clock::time_point m_presentInput;
+    Clock::time_point m_paintStart;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief time the GUI thread spends on each frame, paintGL to the swap or the publish
+    //----------------------------------------------------------------------------------------------------------------------
+    FrameLatency m_stall;
 
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief owns the context the renderer was made with when on, so it is declared before the renderer and
+    /// outlives it
+    //----------------------------------------------------------------------------------------------------------------------
+    RenderThread m_renderThread;
+
+    // the drawing thread
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief does all of the grid drawing, shared with the offscreen benchmark
+    //----------------------------------------------------------------------------------------------------------------------
+    GridRenderer m_renderer;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the state the last frame was drawn from, to tell what changed
+    //----------------------------------------------------------------------------------------------------------------------
+    SceneState m_applied;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the cell under the cursor, highlighted and shown on the overlay, and the clicks reported
+    //----------------------------------------------------------------------------------------------------------------------
+    GridPicker::Hit m_picked;
+    uint32_t m_clicks=0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief time from the first input a frame answers to that frame's swap
+    //----------------------------------------------------------------------------------------------------------------------
+    FrameLatency m_latency;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief records the frames drawn, rendering continuously while it runs. The size is set before the
+    /// window shows.
+    //----------------------------------------------------------------------------------------------------------------------
+    FrameCapture m_capture;
+    int m_captureWidth=0;
+    int m_captureHeight=0;
+    bool m_captureRaw=false;
 };
 
 
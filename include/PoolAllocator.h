@@ -0,0 +1,87 @@
+#ifndef POOLALLOCATOR_H_
+#define POOLALLOCATOR_H_
+#include <cstddef>
+#include <new>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file PoolAllocator.h
+/// @brief recycled storage for the nodes of long lived std::list and std::unordered_map containers
+/// @class NodePool
+/// @brief hands out nodes of one size from chunks of NodesPerChunk, freed nodes go on a free list and
+/// are reused before another chunk is taken. The node size is set by the first allocation. Chunks are
+/// only returned to the heap when the pool is destroyed, so a container that keeps inserting and
+/// erasing around a steady size stops allocating once it has reached it. Not thread safe.
+//----------------------------------------------------------------------------------------------------------------------
+
+class NodePool
+{
+  public:
+    static constexpr size_t NodesPerChunk = 256;
+    NodePool()=default;
+    NodePool(const NodePool &)=delete;
+    NodePool &operator=(const NodePool &)=delete;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief dtor frees every chunk, the containers using the pool must already be gone
+    //----------------------------------------------------------------------------------------------------------------------
+    ~NodePool();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief true if nodes of _bytes come from this pool, the first size asked about becomes the node size
+    //----------------------------------------------------------------------------------------------------------------------
+    bool serves(size_t _bytes);
+    void *allocate();
+    void deallocate(void *_node);
+    size_t chunks() const { return m_chunks.size(); }
+
+  private:
+    struct FreeNode
+    {
+      FreeNode *next;
+    };
+    size_t m_nodeBytes=0;
+    FreeNode *m_free=nullptr;
+    std::vector<void *> m_chunks;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class PoolAllocator
+/// @brief std allocator taking single nodes from a NodePool, arrays (hash buckets) still come from the heap
+//----------------------------------------------------------------------------------------------------------------------
+template <typename T>
+class PoolAllocator
+{
+  public:
+    typedef T value_type;
+    template <typename U> struct rebind { typedef PoolAllocator<U> other; };
+
+    explicit PoolAllocator(NodePool *_pool) : m_pool(_pool) {}
+    template <typename U> PoolAllocator(const PoolAllocator<U> &_other) : m_pool(_other.pool()) {}
+
+    T *allocate(size_t _n)
+    {
+      if(_n == 1 && m_pool->serves(sizeof(T)))
+      {
+        return static_cast<T *>(m_pool->allocate());
+      }
+      return static_cast<T *>(::operator new(_n*sizeof(T)));
+    }
+    void deallocate(T *_p, size_t _n)
+    {
+      if(_n == 1 && m_pool->serves(sizeof(T)))
+      {
+        m_pool->deallocate(_p);
+        return;
+      }
+      ::operator delete(_p);
+    }
+    NodePool *pool() const { return m_pool; }
+
+  private:
+    NodePool *m_pool;
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T> &_a, const PoolAllocator<U> &_b) { return _a.pool() == _b.pool(); }
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T> &_a, const PoolAllocator<U> &_b) { return _a.pool() != _b.pool(); }
+
+#endif
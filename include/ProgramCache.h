@@ -0,0 +1,106 @@
+#ifndef PROGRAMCACHE_H_
+#define PROGRAMCACHE_H_
+#include <ngl/Types.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file ProgramCache.h
+/// @brief builds the grid's GL programs, reusing linked binaries from earlier runs
+/// @class ProgramCache
+/// @brief request() reads a program's sources and hashes them with its defines and the driver's vendor,
+/// renderer and version strings. If a binary stored under that hash exists it is loaded with glProgramBinary.
+/// Otherwise the program is compiled and linked without querying any status, so a driver with
+/// KHR_parallel_shader_compile builds it on its own threads while the caller carries on. take() waits for
+/// the result and stores the binary of anything it had to compile. A binary the driver rejects counts
+/// as a miss and the program is compiled from source.
+//----------------------------------------------------------------------------------------------------------------------
+
+class ProgramCache
+{
+  public:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief one shader of a program, the source is read from _path
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Stage
+    {
+      GLenum type;
+      const char *path;
+    };
+    struct Stats
+    {
+      /// programs loaded from a stored binary
+      unsigned int hits=0;
+      /// programs compiled from source, including rejected binaries
+      unsigned int misses=0;
+      /// programs that failed to build
+      unsigned int failures=0;
+      /// time from request to take summed over the hits and the misses
+      double loadMs=0.0;
+      double compileMs=0.0;
+      /// the driver compiles on its own threads
+      bool parallel=false;
+    };
+    using Handle = size_t;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ctor needs a current context
+    /// @param [in] _directory where binaries are kept, empty to always compile from source
+    //----------------------------------------------------------------------------------------------------------------------
+    explicit ProgramCache(const std::string &_directory);
+    ProgramCache(const ProgramCache &)=delete;
+    ProgramCache &operator=(const ProgramCache &)=delete;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief dtor deletes any program that was requested but never taken
+    //----------------------------------------------------------------------------------------------------------------------
+    ~ProgramCache();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief start building a program
+    /// @param [in] _name names the program in the report and its binary file
+    /// @param [in] _stages the shaders to link
+    /// @param [in] _defines each one becomes a #define after the #version line of every stage
+    //----------------------------------------------------------------------------------------------------------------------
+    Handle request(const std::string &_name, const std::vector<Stage> &_stages,
+                   const std::vector<std::string> &_defines=std::vector<std::string>());
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief true once take() would not block
+    //----------------------------------------------------------------------------------------------------------------------
+    bool ready(Handle _handle) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief wait for a requested program, the caller owns it from here
+    /// @returns the program or 0 if it failed to build, the log goes to std::cerr
+    //----------------------------------------------------------------------------------------------------------------------
+    GLuint take(Handle _handle);
+    const Stats &stats() const { return m_stats; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief a line per taken program and a total
+    //----------------------------------------------------------------------------------------------------------------------
+    void report(std::ostream &_out) const;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+    struct Entry
+    {
+      std::string name;
+      std::string file;
+      uint64_t key=0;
+      std::vector<GLuint> shaders;
+      GLuint program=0;
+      bool hit=false;
+      bool taken=false;
+      Clock::time_point start;
+      double ms=0.0;
+    };
+    bool load(Entry &_entry) const;
+    void store(const Entry &_entry) const;
+    void enableParallelCompile();
+
+    std::string m_directory;
+    std::string m_driver;
+    std::vector<Entry> m_entries;
+    Stats m_stats;
+};
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef RENDERQUEUE_H_
+#define RENDERQUEUE_H_
+#include "FrameArena.h"
+#include <cstddef>
+#include <cstdint>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file RenderQueue.h
+/// @brief draw packets sorted by a 64 bit key so state only changes when it has to
+/// @class RenderQueue
+/// @brief every visible cell submits a packet of its instance and a key packing, most significant first,
+/// the shader, the mesh, the material and the depth. sort() radix sorts the packets on the key, one 8 bit
+/// digit per pass, skipping the digits every key shares. Consecutive packets with the same shader, mesh and
+/// material then form one batch, drawn with a single instanced call, and within a batch the cells run
+/// front to back. The state changes of drawing the packets in submission order and in sorted order are
+/// both counted. The packets and batches live in a FrameArena, so they only last until its next reset.
+/// Knows nothing about GL, the renderer turns batches into draws.
+//----------------------------------------------------------------------------------------------------------------------
+
+class RenderQueue
+{
+  public:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief bits of each field of the key, the depth takes the low 32
+    //----------------------------------------------------------------------------------------------------------------------
+    static constexpr uint32_t ShaderBits = 8;
+    static constexpr uint32_t MeshBits = 12;
+    static constexpr uint32_t MaterialBits = 12;
+    static constexpr uint32_t DepthBits = 32;
+    struct Packet
+    {
+      uint64_t key;
+      /// index of the cell in the instance buffer
+      uint32_t instance;
+      uint32_t pad;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief a run of sorted packets sharing their state, [first, first+count) of packets()
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Batch
+    {
+      uint32_t shader;
+      uint32_t mesh;
+      uint32_t material;
+      uint32_t first;
+      uint32_t count;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief binds needed to draw the packets in some order, the first packet binds everything
+    //----------------------------------------------------------------------------------------------------------------------
+    struct StateChanges
+    {
+      uint32_t programs=0;
+      uint32_t meshes=0;
+      uint32_t materials=0;
+      uint32_t total() const { return programs+meshes+materials; }
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the shader, mesh and material part of a key, shifted down, the same for every frame a cell is drawn
+    //----------------------------------------------------------------------------------------------------------------------
+    static uint32_t state(uint32_t _shader, uint32_t _mesh, uint32_t _material)
+    {
+      return (_shader << (MeshBits+MaterialBits)) | (_mesh << MaterialBits) | _material;
+    }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the full key for a cell _depth in front of the eye, any float orders correctly
+    //----------------------------------------------------------------------------------------------------------------------
+    static uint64_t key(uint32_t _state, float _depth);
+    static uint32_t shader(uint64_t _key) { return static_cast<uint32_t>(_key >> (DepthBits+MeshBits+MaterialBits)); }
+    static uint32_t mesh(uint64_t _key) { return static_cast<uint32_t>(_key >> (DepthBits+MaterialBits)) & ((1u << MeshBits)-1); }
+    static uint32_t material(uint64_t _key) { return static_cast<uint32_t>(_key >> DepthBits) & ((1u << MaterialBits)-1); }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief start a new queue of _count packets from _arena, written through packets() from any number
+    /// of threads, the arena must outlive the draws of the batches
+    //----------------------------------------------------------------------------------------------------------------------
+    void reset(size_t _count, FrameArena &_arena);
+    Packet *packets() { return m_packets; }
+    const Packet *packets() const { return m_packets; }
+    size_t size() const { return m_count; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief count the unsorted state changes, sort the packets and build the batches
+    //----------------------------------------------------------------------------------------------------------------------
+    void sort();
+    const Batch *batches() const { return m_batches; }
+    size_t batchCount() const { return m_batchCount; }
+    const StateChanges &unsortedChanges() const { return m_unsorted; }
+    const StateChanges &sortedChanges() const { return m_sorted; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief radix passes the last sort made, at most 8
+    //----------------------------------------------------------------------------------------------------------------------
+    uint32_t passes() const { return m_passes; }
+
+  private:
+    static StateChanges countChanges(const Packet *_packets, size_t _count);
+
+    FrameArena *m_arena=nullptr;
+    Packet *m_packets=nullptr;
+    size_t m_count=0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the other buffer of each radix pass, both taken from the arena by reset
+    //----------------------------------------------------------------------------------------------------------------------
+    Packet *m_scratch=nullptr;
+    Batch *m_batches=nullptr;
+    size_t m_batchCount=0;
+    StateChanges m_unsorted;
+    StateChanges m_sorted;
+    uint32_t m_passes=0;
+};
+
+#endif
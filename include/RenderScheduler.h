@@ -0,0 +1,72 @@
+#ifndef RENDERSCHEDULER_H_
+#define RENDERSCHEDULER_H_
+#include <cstdint>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file RenderScheduler.h
+/// @brief decides when the window actually needs to draw
+/// @class RenderScheduler
+/// @brief input handlers mark what changed with invalidate() instead of repainting. Only the first change
+/// after a frame asks the window for an update, later ones are folded into that same frame, so a burst
+/// of mouse events costs one frame per vsync at most. paintGL calls beginFrame() and skips drawing when
+/// nothing is dirty (an expose event for example) as the window keeps its last frame.
+//----------------------------------------------------------------------------------------------------------------------
+
+class RenderScheduler
+{
+  public:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the state that can make a frame stale
+    //----------------------------------------------------------------------------------------------------------------------
+    enum Dirty : uint32_t
+    {
+      None = 0,
+      /// mouse rotation (spinXFace / spinYFace)
+      Rotation = 1<<0,
+      /// model position (pan and zoom)
+      Position = 1<<1,
+      /// framebuffer size and projection
+      Projection = 1<<2,
+      /// draw, cull or level of detail mode, wireframe and so on
+      Settings = 1<<3,
+      /// the profiler overlay is showing and needs a new sample every refresh
+      Profile = 1<<4,
+      /// frames are being recorded, every refresh is drawn and captured
+      Capture = 1<<5,
+      /// streamed tiles are still being built, drawn again until they have all arrived
+      Streaming = 1<<6,
+      /// the cursor moved, or the cell under it changed
+      Pick = 1<<7,
+      /// occlusion culling tested against a depth pyramid from another view, drawn again until they match
+      Occlusion = 1<<8,
+      All = 0xffffffffu
+    };
+    struct Counters
+    {
+      /// invalidate() calls that changed something
+      uint64_t requested=0;
+      /// requests folded into a frame that was already pending
+      uint64_t coalesced=0;
+      uint64_t rendered=0;
+      /// paints with nothing dirty
+      uint64_t skipped=0;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief mark _dirty as changed, starts dirty so the first frame always draws
+    /// @returns true if the caller should ask the window for an update, false if one is already pending
+    //----------------------------------------------------------------------------------------------------------------------
+    bool invalidate(uint32_t _dirty);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief called at the start of paintGL, clears the dirty state
+    /// @returns what changed since the last drawn frame, None if the frame can be skipped
+    //----------------------------------------------------------------------------------------------------------------------
+    uint32_t beginFrame();
+    uint32_t dirty() const { return m_dirty; }
+    const Counters &counters() const { return m_counters; }
+
+  private:
+    uint32_t m_dirty=All;
+    bool m_pending=false;
+    Counters m_counters;
+};
+
+#endif
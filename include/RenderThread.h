@@ -0,0 +1,122 @@
+#ifndef RENDERTHREAD_H_
+#define RENDERTHREAD_H_
+#include "SceneState.h"
+#include "TripleBuffer.h"
+#include <ngl/Types.h>
+#include <QOpenGLContext>
+#include <QSurfaceFormat>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+class QThread;
+class QWindow;
+//----------------------------------------------------------------------------------------------------------------------
+/// @file RenderThread.h
+/// @brief draws and presents a window's frames on a thread of its own
+/// @class RenderThread
+/// @brief the thread creates its own QOpenGLContext for the window and sleeps until the GUI thread
+/// publishes a SceneState. Snapshots go through a TripleBuffer so publishing never waits on a frame
+/// being drawn, the mutex only guards the thread's sleep. The thread always draws the newest snapshot,
+/// ones published while it was busy are replaced and counted as coalesced. Presenting is paced by the
+/// swap interval: after each swap the thread waits for the GPU to reach it, so it never queues frames
+/// ahead of the display and the next snapshot is taken as late as possible.
+//----------------------------------------------------------------------------------------------------------------------
+
+class RenderThread
+{
+  public:
+    struct Callbacks
+    {
+      //----------------------------------------------------------------------------------------------------------------------
+      /// @brief called once on the thread with the context current
+      //----------------------------------------------------------------------------------------------------------------------
+      std::function<void()> initialize;
+      //----------------------------------------------------------------------------------------------------------------------
+      /// @brief draw _state into the default framebuffer. _dirty is what changed, the snapshot's dirty flags if
+      /// it is new plus whatever the last call asked for. Sets o_drawn if there is a frame to present and
+      /// returns the RenderScheduler::Dirty flags wanting another frame even without a new snapshot.
+      //----------------------------------------------------------------------------------------------------------------------
+      std::function<uint32_t(const SceneState &_state, uint32_t _dirty, GLuint _framebuffer, bool &o_drawn)> frame;
+      //----------------------------------------------------------------------------------------------------------------------
+      /// @brief called once the frame drawn from _state is on its way to the display, _fresh if _state was
+      /// taken for that frame rather than kept from an earlier one
+      //----------------------------------------------------------------------------------------------------------------------
+      std::function<void(const SceneState &_state, bool _fresh)> presented;
+    };
+    struct Counters
+    {
+      /// snapshots the thread took
+      uint64_t taken=0;
+      /// snapshots replaced before the thread took them
+      uint64_t coalesced=0;
+      uint64_t rendered=0;
+      /// wake ups with nothing to draw
+      uint64_t skipped=0;
+    };
+    RenderThread()=default;
+    RenderThread(const RenderThread &)=delete;
+    RenderThread &operator=(const RenderThread &)=delete;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief dtor stops the thread, the context is destroyed with it
+    //----------------------------------------------------------------------------------------------------------------------
+    ~RenderThread();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief false if the platform can not use OpenGL from a second thread
+    //----------------------------------------------------------------------------------------------------------------------
+    static bool supported();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief start drawing _window, which must be exposed and an OpenGL surface
+    //----------------------------------------------------------------------------------------------------------------------
+    void start(QWindow *_window, const QSurfaceFormat &_format, const Callbacks &_callbacks);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief let the current frame finish and join the thread. The context is handed to the calling thread,
+    /// made current, so whatever the callbacks created can still be released.
+    //----------------------------------------------------------------------------------------------------------------------
+    void stop();
+    bool running() const { return m_thread.joinable(); }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the slot the next snapshot is written into, GUI thread only
+    //----------------------------------------------------------------------------------------------------------------------
+    SceneState &snapshot() { return m_snapshots.back(); }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief hand snapshot() to the thread and wake it, GUI thread only
+    //----------------------------------------------------------------------------------------------------------------------
+    void publish();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief sequence of the last snapshot the thread took
+    //----------------------------------------------------------------------------------------------------------------------
+    uint64_t consumed() const { return m_consumed.load(std::memory_order_acquire); }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief only complete once the thread has stopped
+    //----------------------------------------------------------------------------------------------------------------------
+    Counters counters() const;
+
+  private:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief body of the render thread
+    //----------------------------------------------------------------------------------------------------------------------
+    void run();
+
+    QWindow *m_window=nullptr;
+    Callbacks m_callbacks;
+    QSurfaceFormat m_format;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief created and used on the render thread, handed back to m_owner by stop()
+    //----------------------------------------------------------------------------------------------------------------------
+    std::unique_ptr<QOpenGLContext> m_context;
+    QThread *m_owner=nullptr;
+    TripleBuffer<SceneState> m_snapshots;
+    std::atomic<uint64_t> m_consumed{0};
+    uint64_t m_coalesced=0;
+    Counters m_counters;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::atomic<bool> m_running{false};
+    std::thread m_thread;
+};
+
+#endif
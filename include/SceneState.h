@@ -0,0 +1,65 @@
+#ifndef SCENESTATE_H_
+#define SCENESTATE_H_
+#include "WindowParams.h"
+#include "GridRenderer.h"
+#include "RenderScheduler.h"
+#include <ngl/Vec3.h>
+#include <chrono>
+#include <cstdint>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file SceneState.h
+/// @brief everything input changes about the next frame, as a plain value
+/// @class SceneState
+/// @brief the GUI thread edits its own SceneState from input and a frame is only ever drawn from a copy
+/// of it, so with the render thread on the two threads never share anything the GUI thread writes.
+/// Actions with side effects (tracing and recording) are counts of key presses rather than flags, so
+/// the side drawing the frame toggles whatever state it actually finds.
+//----------------------------------------------------------------------------------------------------------------------
+
+struct SceneState
+{
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief increases with every copy handed to the render thread
+  //----------------------------------------------------------------------------------------------------------------------
+  uint64_t sequence=0;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief RenderScheduler::Dirty flags changed since the render thread last took a copy
+  //----------------------------------------------------------------------------------------------------------------------
+  uint32_t dirty=RenderScheduler::All;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief when the earliest input not yet drawn arrived, the start of the input to present latency
+  //----------------------------------------------------------------------------------------------------------------------
+  std::chrono::steady_clock::time_point input;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief mouse rotation, framebuffer size and the pan and zoom
+  //----------------------------------------------------------------------------------------------------------------------
+  WinParams win;
+  ngl::Vec3 modelPos;
+  float pixelRatio=1.0f;
+  bool exposed=true;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief renderer settings, read from the renderer when the window first shows
+  //----------------------------------------------------------------------------------------------------------------------
+  GridRenderer::DrawMode drawMode=GridRenderer::DrawMode::Instanced;
+  GridRenderer::CullMode cullMode=GridRenderer::CullMode::Cpu;
+  bool lod=true;
+  bool occlusion=false;
+  bool wireframe=false;
+  bool overlay=false;
+  uint32_t traceToggles=0;
+  uint32_t captureToggles=0;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief the cursor in framebuffer pixels once the mouse has moved, and left clicks so far
+  //----------------------------------------------------------------------------------------------------------------------
+  bool cursor=false;
+  float cursorX=0.0f;
+  float cursorY=0.0f;
+  uint32_t clicks=0;
+  //----------------------------------------------------------------------------------------------------------------------
+  /// @brief GUI thread time spent handing over the last frame and the most it has ever spent, for the overlay
+  //----------------------------------------------------------------------------------------------------------------------
+  double stallMs=0.0;
+  double stallMaxMs=0.0;
+};
+
+#endif
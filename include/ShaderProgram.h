@@ -0,0 +1,96 @@
+#ifndef SHADERPROGRAM_H_
+#define SHADERPROGRAM_H_
+#include <ngl/Types.h>
+#include <ngl/Mat4.h>
+#include <ngl/Vec3.h>
+#include <ngl/Vec4.h>
+#include <cstring>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file ShaderProgram.h
+/// @brief typed uniform binding for the grid shaders
+/// @class ShaderProgram
+/// @brief a linked GL program that remembers which program is current so use() only calls glUseProgram
+/// when it actually changes. Uniform locations are resolved once through Uniform and nothing is looked
+/// up by name while drawing.
+//----------------------------------------------------------------------------------------------------------------------
+
+class ShaderProgram
+{
+  public:
+    ShaderProgram()=default;
+    explicit ShaderProgram(GLuint _id) : m_id(_id) {}
+    GLuint id() const { return m_id; }
+    bool valid() const { return m_id != 0; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief make this program current unless it already is
+    /// @returns true if glUseProgram was called
+    //----------------------------------------------------------------------------------------------------------------------
+    bool use() const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief forget the tracked program, call when other code (NGL, Qt) may have bound one behind our back
+    //----------------------------------------------------------------------------------------------------------------------
+    static void resetCurrent() { s_current=0; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief resolve a uniform location, only called at init
+    //----------------------------------------------------------------------------------------------------------------------
+    GLint location(const char *_name) const;
+
+  private:
+    GLuint m_id=0;
+    static GLuint s_current;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @brief glUniform for each type used by the grid shaders, the program must be current
+//----------------------------------------------------------------------------------------------------------------------
+namespace UniformUpload
+{
+  inline void upload(GLint _location, const float *_value, GLsizei _count) { glUniform1fv(_location, _count, _value); }
+  inline void upload(GLint _location, const GLint *_value, GLsizei _count) { glUniform1iv(_location, _count, _value); }
+  inline void upload(GLint _location, const GLuint *_value, GLsizei _count) { glUniform1uiv(_location, _count, _value); }
+  inline void upload(GLint _location, const ngl::Vec3 *_value, GLsizei _count) { glUniform3fv(_location, _count, &_value->m_x); }
+  inline void upload(GLint _location, const ngl::Vec4 *_value, GLsizei _count) { glUniform4fv(_location, _count, _value->m_openGL); }
+  inline void upload(GLint _location, const ngl::Mat4 *_value, GLsizei _count) { glUniformMatrix4fv(_location, _count, GL_FALSE, _value->m_openGL); }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+/// @class Uniform
+/// @brief a uniform of type T at a location resolved once, set() skips the upload if the value has not
+/// changed since the last one. The owning program must be current when setting.
+//----------------------------------------------------------------------------------------------------------------------
+template <typename T>
+class Uniform
+{
+  public:
+    void resolve(const ShaderProgram &_program, const char *_name)
+    {
+      m_location = _program.location(_name);
+      m_cached = false;
+    }
+    GLint location() const { return m_location; }
+    void set(const T &_value)
+    {
+      if(m_cached && std::memcmp(&m_value, &_value, sizeof(T)) == 0)
+      {
+        return;
+      }
+      m_value = _value;
+      m_cached = true;
+      UniformUpload::upload(m_location, &m_value, 1);
+    }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief upload an array uniform, never cached
+    //----------------------------------------------------------------------------------------------------------------------
+    void set(const T *_values, GLsizei _count)
+    {
+      m_cached = false;
+      UniformUpload::upload(m_location, _values, _count);
+    }
+
+  private:
+    GLint m_location=-1;
+    T m_value;
+    bool m_cached=false;
+};
+
+#endif
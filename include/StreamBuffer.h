@@ -0,0 +1,102 @@
+#ifndef STREAMBUFFER_H_
+#define STREAMBUFFER_H_
+#include <ngl/Types.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file StreamBuffer.h
+/// @brief ring buffer for data written by the CPU every frame
+/// @class StreamBuffer
+/// @brief one persistently and coherently mapped buffer split into Regions equal regions. Each frame
+/// allocates linearly from its own region and fences it at the end, so the CPU fills frame N+1 while the
+/// GPU still reads frame N and only waits if it gets Regions frames ahead. A frame that outgrows its
+/// region moves the stream to a buffer twice the size. The old buffer stays alive until the GPU has
+/// finished the frames that used it.
+//----------------------------------------------------------------------------------------------------------------------
+
+class StreamBuffer
+{
+  public:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief frames in flight
+    //----------------------------------------------------------------------------------------------------------------------
+    static constexpr uint32_t Regions = 3;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief a slice of the current region, write to data then bind buffer at offset
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Allocation
+    {
+      void *data=nullptr;
+      GLuint buffer=0;
+      GLintptr offset=0;
+      GLsizeiptr size=0;
+    };
+    struct Counters
+    {
+      /// frames that had to wait for the GPU to release their region
+      uint64_t fenceWaits=0;
+      double fenceWaitMs=0.0;
+      /// times a frame outgrew its region
+      uint64_t grows=0;
+    };
+    StreamBuffer()=default;
+    StreamBuffer(const StreamBuffer &)=delete;
+    StreamBuffer &operator=(const StreamBuffer &)=delete;
+    ~StreamBuffer();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief create the buffer, needs a current context
+    /// @param [in] _regionBytes initial size of each region
+    //----------------------------------------------------------------------------------------------------------------------
+    void create(size_t _regionBytes);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief move to the next region, waiting for the GPU if it is still reading it
+    //----------------------------------------------------------------------------------------------------------------------
+    void beginFrame();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief fence everything allocated since beginFrame
+    //----------------------------------------------------------------------------------------------------------------------
+    void endFrame();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief _bytes from the current region, valid until the end of the frame
+    /// @param [in] _alignment offset alignment, a power of two (see uniformAlignment())
+    //----------------------------------------------------------------------------------------------------------------------
+    Allocation allocate(size_t _bytes, size_t _alignment=16);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief copy _bytes from _data into a new allocation
+    //----------------------------------------------------------------------------------------------------------------------
+    Allocation upload(const void *_data, size_t _bytes, size_t _alignment=16);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief glBindBufferRange an allocation to an indexed target (uniform or shader storage)
+    //----------------------------------------------------------------------------------------------------------------------
+    static void bindRange(GLenum _target, GLuint _index, const Allocation &_allocation);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, read at create
+    //----------------------------------------------------------------------------------------------------------------------
+    size_t uniformAlignment() const { return m_uniformAlignment; }
+    const Counters &counters() const { return m_counters; }
+
+  private:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief make a new mapped buffer of Regions*_regionBytes, retiring the current one
+    //----------------------------------------------------------------------------------------------------------------------
+    void allocateStorage(size_t _regionBytes);
+    struct Retired
+    {
+      GLuint buffer;
+      /// the last frame that used it
+      uint64_t frame;
+    };
+    GLuint m_buffer=0;
+    char *m_data=nullptr;
+    size_t m_regionBytes=0;
+    size_t m_uniformAlignment=256;
+    uint32_t m_region=0;
+    size_t m_head=0;
+    GLsync m_fences[Regions]={nullptr, nullptr, nullptr};
+    uint64_t m_frame=0;
+    std::vector<Retired> m_retired;
+    Counters m_counters;
+};
+
+#endif
@@ -0,0 +1,211 @@
+#ifndef TILESTREAMER_H_
+#define TILESTREAMER_H_
+#include "FrameArena.h"
+#include "GridKernel.h"
+#include "GridModel.h"
+#include "PoolAllocator.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file TileStreamer.h
+/// @brief the unbounded grid, built tile by tile around the camera
+/// @class TileStreamer
+/// @brief cell (gx, gz) of the unbounded grid sits at (gx*step, 0, gz*step) and tiles are TileSize square
+/// blocks of cells. Each update asks for every tile within the view distance of the camera, nearest
+/// first, and builder threads fill their matrices and colours in the background. Finished tiles are
+/// given one of capacity() slots, the number of tiles that fit in the memory budget, and handed out as
+/// uploads, at most MaxUploads a frame so panning never causes a spike. When the slots run out the least
+/// recently used tile the camera no longer needs is evicted. Its slot is only reused StreamBuffer::Regions
+/// frames later so the GPU has finished reading it. No GL calls are made here, the owner copies the
+/// uploads to its own buffer at slot*TileCells. The resident tile map and its LRU list take their nodes
+/// from NodePools and the arrays of uploaded tiles go back to the builders, so streaming tiles in and
+/// out at a steady rate stops allocating once the pools have grown.
+//----------------------------------------------------------------------------------------------------------------------
+
+class TileStreamer
+{
+  public:
+    static constexpr uint32_t TileSize = GridModel::TileSize;
+    static constexpr uint32_t TileCells = TileSize*TileSize;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief CPU and GPU bytes of one tile, a matrix and a colour per cell
+    //----------------------------------------------------------------------------------------------------------------------
+    static constexpr size_t TileBytes = TileCells*(sizeof(ngl::Mat4)+sizeof(ngl::Vec4));
+    static constexpr uint32_t MaxUploads = 16;
+    struct Tile
+    {
+      int32_t tx;
+      int32_t tz;
+      uint32_t slot;
+      /// grid space bounds of every cell in the tile
+      float min[3];
+      float max[3];
+      /// level of detail last frame, for the hysteresis
+      uint32_t level;
+      /// last frame the tile was within the view distance
+      uint64_t used;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief TileCells models and colours to copy to slot, valid until the next update
+    //----------------------------------------------------------------------------------------------------------------------
+    struct Upload
+    {
+      uint32_t slot;
+      const ngl::Mat4 *models;
+      const ngl::Vec4 *colours;
+    };
+    struct Stats
+    {
+      /// tiles with a slot
+      uint32_t resident=0;
+      /// tiles within the view distance and those of them not built yet
+      uint32_t needed=0;
+      uint32_t missing=0;
+      /// tiles waiting for or being built
+      uint32_t queued=0;
+      /// tiles uploaded this frame
+      uint32_t uploaded=0;
+      uint64_t evicted=0;
+      /// radius of the square of tiles kept around the camera, in tiles
+      uint32_t radius=0;
+      size_t bytes=0;
+    };
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief ctor only sets up the slots, the builders start with the first update that requests a tile
+    /// @param [in] _threads builder threads, 0 for a quarter of the cores
+    //----------------------------------------------------------------------------------------------------------------------
+    explicit TileStreamer(unsigned int _threads=0);
+    TileStreamer(const TileStreamer &)=delete;
+    TileStreamer &operator=(const TileStreamer &)=delete;
+    ~TileStreamer();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief cell spacing and scale, changing either drops every tile
+    //----------------------------------------------------------------------------------------------------------------------
+    void setLayout(float _step, float _scale);
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief memory for resident tiles, changing the capacity it gives drops every tile. Also limits the
+    /// view distance so the tiles it covers always fit.
+    //----------------------------------------------------------------------------------------------------------------------
+    void setBudget(size_t _bytes);
+    size_t budget() const { return m_budget; }
+    uint32_t capacity() const { return m_capacity; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief request the tiles around the camera and collect the finished ones
+    /// @param [in] _x, _z the camera position projected on the grid
+    /// @param [in] _distance the furthest a visible cell can be from the camera
+    /// @param [in] _frame the frame number, increasing
+    /// @param [in] _arena frame scratch for the list of missing tiles
+    //----------------------------------------------------------------------------------------------------------------------
+    void update(float _x, float _z, float _distance, uint64_t _frame, FrameArena &_arena);
+    const std::vector<Upload> &uploads() const { return m_uploads; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the resident tiles within the view distance, valid until the next update
+    //----------------------------------------------------------------------------------------------------------------------
+    const std::vector<Tile *> &tiles() const { return m_visible; }
+    float cellRadius() const { return GridModel::CellExtent*m_scale; }
+    const Stats &stats() const { return m_stats; }
+
+  private:
+    struct Request
+    {
+      uint64_t key;
+      int32_t tx;
+      int32_t tz;
+      float step;
+      float scale;
+      uint32_t generation;
+    };
+    struct Built
+    {
+      Request request;
+      GridKernel::MatrixArray models;
+      GridKernel::ColourArray colours;
+    };
+    struct Entry
+    {
+      Tile tile;
+      std::list<uint64_t, PoolAllocator<uint64_t>>::iterator lru;
+    };
+    static uint64_t key(int32_t _tx, int32_t _tz)
+    {
+      return (static_cast<uint64_t>(static_cast<uint32_t>(_tx)) << 32) | static_cast<uint32_t>(_tz);
+    }
+    void build(const Request &_request, Built &o_built) const;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief body of each builder thread
+    //----------------------------------------------------------------------------------------------------------------------
+    void builder();
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief a slot for a new tile, evicting if needed, returns false if none can be reused yet
+    //----------------------------------------------------------------------------------------------------------------------
+    bool acquireSlot(uint64_t _frame, uint32_t &o_slot);
+    void clear();
+    typedef std::unordered_map<uint64_t, Entry, std::hash<uint64_t>, std::equal_to<uint64_t>,
+                               PoolAllocator<std::pair<const uint64_t, Entry>>> EntryMap;
+    typedef std::list<uint64_t, PoolAllocator<uint64_t>> LruList;
+    typedef std::unordered_set<uint64_t, std::hash<uint64_t>, std::equal_to<uint64_t>, PoolAllocator<uint64_t>> KeySet;
+
+    float m_step=0.5f;
+    float m_scale=0.2f;
+    size_t m_budget=64u << 20;
+    uint32_t m_capacity=0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief bumped by every layout or budget change so builds started before it are thrown away
+    //----------------------------------------------------------------------------------------------------------------------
+    uint32_t m_generation=0;
+    uint64_t m_frame=0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief node storage of the containers below, one pool per node size, declared first so they outlive them
+    //----------------------------------------------------------------------------------------------------------------------
+    NodePool m_entryPool;
+    NodePool m_lruPool;
+    NodePool m_requestedPool;
+    EntryMap m_entries;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief resident tiles, most recently used first
+    //----------------------------------------------------------------------------------------------------------------------
+    LruList m_lru;
+    std::vector<uint32_t> m_freeSlots;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief evicted slots and the frame they were evicted in, free again StreamBuffer::Regions frames later
+    //----------------------------------------------------------------------------------------------------------------------
+    std::deque<std::pair<uint32_t, uint64_t>> m_retired;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief keys queued or being built, only touched by the calling thread
+    //----------------------------------------------------------------------------------------------------------------------
+    KeySet m_requested;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief built tiles waiting for a slot, and the ones uploaded this frame
+    //----------------------------------------------------------------------------------------------------------------------
+    std::deque<Built> m_ready;
+    std::vector<Built> m_uploading;
+    std::vector<Upload> m_uploads;
+    std::vector<Tile *> m_visible;
+    Stats m_stats;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<Request> m_queue;
+    std::vector<Built> m_done;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief arrays of tiles uploaded by earlier updates, taken by the builders before they allocate new ones
+    //----------------------------------------------------------------------------------------------------------------------
+    std::vector<Built> m_spare;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief tiles taken off m_queue but not yet in m_done
+    //----------------------------------------------------------------------------------------------------------------------
+    uint32_t m_building=0;
+    bool m_running=true;
+    unsigned int m_threadCount=1;
+    std::vector<std::thread> m_threads;
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef TRIPLEBUFFER_H_
+#define TRIPLEBUFFER_H_
+#include <atomic>
+#include <cstdint>
+//----------------------------------------------------------------------------------------------------------------------
+/// @file TripleBuffer.h
+/// @brief hands the latest value of T from one thread to another without either ever waiting
+/// @class TripleBuffer
+/// @brief the writer fills back() and publishes it, the reader takes the most recently published value as
+/// front(). Of the three slots one belongs to each side and the third is swapped between them through a
+/// single atomic index, so neither side waits or copies more than its own slot. Values published faster
+/// than they are taken are replaced, the reader only ever sees the newest.
+//----------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+class TripleBuffer
+{
+  public:
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the writer's slot, still holding whatever it held the last time it was swapped back
+    //----------------------------------------------------------------------------------------------------------------------
+    T &back() { return m_slots[m_back]; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief make back() the latest value, writer only
+    /// @returns true if the previous value was never taken and has been replaced
+    //----------------------------------------------------------------------------------------------------------------------
+    bool publish()
+    {
+      // release the writes to back(), acquire the reader's last use of the slot coming back
+      const uint32_t previous = m_shared.exchange(m_back | Fresh, std::memory_order_acq_rel);
+      m_back = previous & Index;
+      return (previous & Fresh) != 0;
+    }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief true if a value has been published since the last take()
+    //----------------------------------------------------------------------------------------------------------------------
+    bool pending() const { return (m_shared.load(std::memory_order_acquire) & Fresh) != 0; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief swap in the latest value as front(), reader only
+    /// @returns false if nothing new was published, front() is then unchanged
+    //----------------------------------------------------------------------------------------------------------------------
+    bool take()
+    {
+      if(!pending())
+      {
+        return false;
+      }
+      m_front = m_shared.exchange(m_front, std::memory_order_acq_rel) & Index;
+      return true;
+    }
+    const T &front() const { return m_slots[m_front]; }
+
+  private:
+    static constexpr uint32_t Index = 3;
+    static constexpr uint32_t Fresh = 4;
+    T m_slots[3];
+    uint32_t m_back=0;
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief the slot between the two sides and whether it holds a value the reader has not taken
+    //----------------------------------------------------------------------------------------------------------------------
+    std::atomic<uint32_t> m_shared{1};
+    uint32_t m_front=2;
+};
+
+template <typename T> constexpr uint32_t TripleBuffer<T>::Index;
+template <typename T> constexpr uint32_t TripleBuffer<T>::Fresh;
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef UNIFORMBLOCK_H_
+#define UNIFORMBLOCK_H_
+#include "StreamBuffer.h"
+//----------------------------------------------------------------------------------------------------------------------
+/// @file UniformBlock.h
+/// @brief a std140 struct bound as a uniform block
+/// @class UniformBlock
+/// @brief T must match the std140 layout of the GLSL block, so mat4 / vec4 members only (or padded by hand).
+/// Every update writes a fresh copy into the frame's StreamBuffer region and binds that range, so frames
+/// still in flight keep reading their own values and the upload never waits on the GPU.
+//----------------------------------------------------------------------------------------------------------------------
+
+template <typename T>
+class UniformBlock
+{
+  public:
+    explicit UniformBlock(GLuint _binding=0) : m_binding(_binding) {}
+    GLuint binding() const { return m_binding; }
+    //----------------------------------------------------------------------------------------------------------------------
+    /// @brief copy _value into _stream and bind it to the block binding point
+    //----------------------------------------------------------------------------------------------------------------------
+    void update(StreamBuffer &_stream, const T &_value) const
+    {
+      StreamBuffer::bindRange(GL_UNIFORM_BUFFER, m_binding, _stream.upload(&_value, sizeof(T), _stream.uniformAlignment()));
+    }
+
+  private:
+    GLuint m_binding;
+};
+
+#endif
@@ -1,9 +1,18 @@
 #version 440 core
 
 layout (location = 0) out vec4 fragColour; // setting the one of the 16 inputs
-uniform vec4 vertColour;
+in vec4 colour; // from the vertex shader, per draw uniform or per instance attribute
+#ifdef LIT
+in vec3 normal;
+#endif
 
 void main()
 {
-    fragColour = vertColour; //setting the color greyscale for the teapot
+#ifdef LIT
+    // a single directional light from above and behind the eye
+    float diffuse = max(dot(normalize(normal), normalize(vec3(0.4, 0.6, 0.7))), 0.0);
+    fragColour = vec4(colour.rgb*(0.35+0.65*diffuse), colour.a);
+#else
+    fragColour = colour; //setting the color greyscale for the teapot
+#endif
 }
@@ -3,11 +3,109 @@
 layout (location = 0) in vec3 inVert; //you tell which direction the input is coming from
 layout (location = 1) in vec3 inNormal;
 layout (location = 2) in vec2 inUV;
-//uniform mat4 MVP = mat4(1); //setting identity to 1
-uniform mat4 MVP;
+// per cell attributes from the instance buffer, every stored path draws through them (the per draw
+// path one instance at a time with baseInstance)
+layout (location = 3) in vec4 inInstanceColour;
+layout (location = 4) in mat4 inInstanceModel; // uses locations 4 to 7
+// per frame camera shared by every draw, laid out std140 so the CPU side is a plain struct
+layout (std140, binding = 0) uniform Camera
+{
+    mat4 view;
+    mat4 project;
+    mat4 mouseRotation;
+    mat4 viewProject; // project*view*mouseRotation
+};
+// the regular layout for the procedural mode, cells are numbered iz*cellsX+ix
+layout (std140, binding = 1) uniform Grid
+{
+    vec4 gridOrigin; // x and z of cell 0, step, scale
+    uvec4 gridCells; // cellsX, cellsZ, number of overrides
+};
+// the few cells that differ from the layout, sorted by cell
+struct CellOverride
+{
+    mat4 model;
+    vec4 colour;
+    uint cell;
+};
+layout (std430, binding = 5) readonly buffer Overrides
+{
+    CellOverride overrides[];
+};
+uniform vec3 lodScale = vec3(1.0); // stretches the coarse level of detail stand ins to the teapot bounds
+uniform bool procedural = false;
+#ifdef QUEUED
+// the render queue draws every batch from one list of instances in sorted order, the model and colour
+// are fetched with it from the instance buffer bound as storage
+layout (location = 8) in uint inQueueCell;
+layout (std430, binding = 6) readonly buffer QueueModels
+{
+    mat4 queueModels[];
+};
+layout (std430, binding = 7) readonly buffer QueueColours
+{
+    vec4 queueColours[];
+};
+uniform vec4 materialTint = vec4(1.0);
+#endif
+
+out vec4 colour;
+#ifdef LIT
+out vec3 normal; // eye space
+#endif
+
+// binary search of the overrides, returns gridCells.z if _cell has none
+uint findOverride(uint _cell)
+{
+    uint low = 0u;
+    uint high = gridCells.z;
+    while(low < high)
+    {
+        uint mid = (low+high)/2u;
+        if(overrides[mid].cell < _cell)
+        {
+            low = mid+1u;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    return (low < gridCells.z && overrides[low].cell == _cell) ? low : gridCells.z;
+}
 
 void main()
 {
-    //mat4 tx = mat4(0.2*inNormal, 0, 0, ); // diagonal matrix setting
-    gl_Position = MVP*vec4(inVert, 1.0); // global variable passed out to the pos
+    mat4 model = inInstanceModel;
+    vec4 cellColour = inInstanceColour;
+    if(procedural)
+    {
+        // same as GridKernel, translate(x, 0, z)*scale(s) and normalize(z, z, x)
+        uint cell = uint(gl_InstanceID);
+        float x = gridOrigin.x+float(cell%gridCells.x)*gridOrigin.z;
+        float z = gridOrigin.y+float(cell/gridCells.x)*gridOrigin.z;
+        float s = gridOrigin.w;
+        model = mat4(s, 0.0, 0.0, 0.0,
+                     0.0, s, 0.0, 0.0,
+                     0.0, 0.0, s, 0.0,
+                     x, 0.0, z, 1.0);
+        vec3 c = vec3(z, z, x);
+        cellColour = vec4(c/length(c), 1.0);
+        uint index = findOverride(cell);
+        if(index < gridCells.z)
+        {
+            model = overrides[index].model;
+            cellColour = overrides[index].colour;
+        }
+    }
+#ifdef QUEUED
+    model = queueModels[inQueueCell];
+    cellColour = queueColours[inQueueCell]*materialTint;
+#endif
+    gl_Position = viewProject*model*vec4(inVert*lodScale, 1.0);
+    colour = cellColour;
+#ifdef LIT
+    // the cells are only ever scaled uniformly so the model matrix can turn the normals as well
+    normal = mat3(view*mouseRotation*model)*inNormal;
+#endif
 }
@@ -0,0 +1,88 @@
+#version 440 core
+
+// frustum and occlusion cull one grid cell per invocation, visible cells are appended to the output
+// instance arrays and counted in the instanceCount of the indirect draw command
+layout (local_size_x = 64) in;
+
+layout (std430, binding = 0) readonly buffer InModels { mat4 inModels[]; };
+layout (std430, binding = 1) readonly buffer InColours { vec4 inColours[]; };
+layout (std430, binding = 2) writeonly buffer OutModels { mat4 outModels[]; };
+layout (std430, binding = 3) writeonly buffer OutColours { vec4 outColours[]; };
+// DrawArraysIndirectCommand followed by the occluded count, count is set and the counts cleared by the
+// CPU each frame
+layout (std430, binding = 4) buffer Command
+{
+    uint count;
+    uint instanceCount;
+    uint first;
+    uint baseInstance;
+    uint occluded;
+} command;
+
+uniform vec4 planes[6]; // grid space, unit normals pointing in
+uniform float cellRadius;
+uniform uint cellCount;
+// the farthest depth pyramid built from the last frame and the grid space clip matrix it was drawn with
+layout (binding = 0) uniform sampler2D pyramid;
+uniform mat4 pyramidViewProject;
+uniform vec4 pyramidInfo; // framebuffer width and height, pyramid levels, 0 levels for no occlusion test
+
+// true if the cell's bounding box was entirely behind what the last frame drew
+bool occluded(vec3 _centre)
+{
+    vec2 lo = vec2(1.0);
+    vec2 hi = vec2(-1.0);
+    float nearest = 1.0;
+    for(int i = 0; i < 8; ++i)
+    {
+        vec3 corner = _centre+cellRadius*vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = pyramidViewProject*vec4(corner, 1.0);
+        // a box reaching behind the eye covers too much of the screen to be worth testing
+        if(clip.w <= 0.0)
+        {
+            return false;
+        }
+        vec3 ndc = clip.xyz/clip.w;
+        lo = min(lo, ndc.xy);
+        hi = max(hi, ndc.xy);
+        nearest = min(nearest, ndc.z*0.5+0.5);
+    }
+    // framebuffer pixels covered, the pyramid texels at level L are 2^(L+1) pixels square so the level
+    // where the box spans at most one texel needs only a 2x2 footprint
+    vec2 pixelLo = clamp(lo*0.5+0.5, 0.0, 1.0)*pyramidInfo.xy;
+    vec2 pixelHi = clamp(hi*0.5+0.5, 0.0, 1.0)*pyramidInfo.xy;
+    vec2 extent = (pixelHi-pixelLo)*0.5;
+    int level = clamp(int(ceil(log2(max(max(extent.x, extent.y), 1.0)))), 0, int(pyramidInfo.z)-1);
+    float texelSize = exp2(float(level+1));
+    ivec2 last = textureSize(pyramid, level)-1;
+    ivec2 a = min(ivec2(pixelLo/texelSize), last);
+    ivec2 b = min(ivec2(pixelHi/texelSize), last);
+    float farthest = max(max(texelFetch(pyramid, a, level).r, texelFetch(pyramid, ivec2(b.x, a.y), level).r),
+                         max(texelFetch(pyramid, ivec2(a.x, b.y), level).r, texelFetch(pyramid, b, level).r));
+    return nearest > farthest;
+}
+
+void main()
+{
+    uint cell = gl_GlobalInvocationID.x;
+    if(cell >= cellCount)
+    {
+        return;
+    }
+    vec4 centre = vec4(inModels[cell][3].xyz, 1.0);
+    for(int i = 0; i < 6; ++i)
+    {
+        if(dot(planes[i], centre) < -cellRadius)
+        {
+            return;
+        }
+    }
+    if(pyramidInfo.z > 0.0 && occluded(centre.xyz))
+    {
+        atomicAdd(command.occluded, 1u);
+        return;
+    }
+    uint slot = atomicAdd(command.instanceCount, 1u);
+    outModels[slot] = inModels[cell];
+    outColours[slot] = inColours[cell];
+}
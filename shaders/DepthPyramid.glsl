@@ -0,0 +1,28 @@
+#version 440 core
+
+// build one level of the hierarchical depth pyramid, each texel is the farthest depth of the 2x2
+// texels under it in the level above. The pyramid is a power of two so a texel at level L always
+// covers the same 2^(L+1) square of framebuffer pixels, reads past the edge of the depth buffer are
+// clamped to it.
+layout (local_size_x = 8, local_size_y = 8) in;
+
+// the copied depth buffer for level 0, else the pyramid itself
+layout (binding = 0) uniform sampler2D source;
+layout (r32f, binding = 0) writeonly uniform image2D destination;
+uniform int sourceLevel;
+
+void main()
+{
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    if(any(greaterThanEqual(texel, imageSize(destination))))
+    {
+        return;
+    }
+    ivec2 last = textureSize(source, sourceLevel)-1;
+    ivec2 base = texel*2;
+    float depth = texelFetch(source, min(base, last), sourceLevel).r;
+    depth = max(depth, texelFetch(source, min(base+ivec2(1, 0), last), sourceLevel).r);
+    depth = max(depth, texelFetch(source, min(base+ivec2(0, 1), last), sourceLevel).r);
+    depth = max(depth, texelFetch(source, min(base+ivec2(1, 1), last), sourceLevel).r);
+    imageStore(destination, texel, vec4(depth));
+}
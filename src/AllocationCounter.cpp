@@ -0,0 +1,67 @@
+#include "AllocationCounter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+// relaxed as only the totals matter, the reader orders them against the frame with its own calls
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_bytes{0};
+
+void *countedAllocate(size_t _bytes)
+{
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  g_bytes.fetch_add(_bytes, std::memory_order_relaxed);
+  // malloc(0) may return null, operator new has to hand out a unique pointer
+  const size_t bytes = _bytes == 0 ? 1 : _bytes;
+  for(;;)
+  {
+    void *p = std::malloc(bytes);
+    if(p != nullptr)
+    {
+      return p;
+    }
+    std::new_handler handler = std::get_new_handler();
+    if(handler == nullptr)
+    {
+      throw std::bad_alloc();
+    }
+    handler();
+  }
+}
+
+void *countedAllocate(size_t _bytes, const std::nothrow_t &) noexcept
+{
+  try
+  {
+    return countedAllocate(_bytes);
+  }
+  catch(...)
+  {
+    return nullptr;
+  }
+}
+}
+
+namespace AllocationCounter
+{
+
+Counts counts()
+{
+  Counts c;
+  c.allocations = g_allocations.load(std::memory_order_relaxed);
+  c.bytes = g_bytes.load(std::memory_order_relaxed);
+  return c;
+}
+
+} // end namespace AllocationCounter
+
+void *operator new(size_t _bytes) { return countedAllocate(_bytes); }
+void *operator new[](size_t _bytes) { return countedAllocate(_bytes); }
+void *operator new(size_t _bytes, const std::nothrow_t &_tag) noexcept { return countedAllocate(_bytes, _tag); }
+void *operator new[](size_t _bytes, const std::nothrow_t &_tag) noexcept { return countedAllocate(_bytes, _tag); }
+void operator delete(void *_p) noexcept { std::free(_p); }
+void operator delete[](void *_p) noexcept { std::free(_p); }
+void operator delete(void *_p, const std::nothrow_t &) noexcept { std::free(_p); }
+void operator delete[](void *_p, const std::nothrow_t &) noexcept { std::free(_p); }
@@ -0,0 +1,58 @@
+#include "FrameArena.h"
+#include <algorithm>
+#include <new>
+
+FrameArena::FrameArena(size_t _bytes)
+{
+  m_stats.capacity = _bytes;
+  m_block = static_cast<char *>(::operator new(_bytes));
+}
+
+FrameArena::~FrameArena()
+{
+  reset();
+  ::operator delete(m_block);
+}
+
+void *FrameArena::allocate(size_t _bytes, size_t _alignment)
+{
+  const size_t offset = (m_head+_alignment-1) & ~(_alignment-1);
+  // the head keeps moving past the end once the block is full, so the peak is the size the whole frame
+  // would have needed and later allocations overflow as well
+  m_head = offset+_bytes;
+  m_stats.used = m_head;
+  m_stats.peak = std::max(m_stats.peak, m_head);
+  if(m_head <= m_stats.capacity)
+  {
+    return m_block+offset;
+  }
+  ++m_stats.overflows;
+  // operator new is aligned for any standard type, larger alignments are not used by the renderer
+  void *block = ::operator new(std::max<size_t>(_bytes, 1));
+  m_overflow.push_back(block);
+  return block;
+}
+
+void FrameArena::reset()
+{
+  m_head = 0;
+  m_stats.used = 0;
+  if(m_overflow.empty())
+  {
+    return;
+  }
+  for(void *block : m_overflow)
+  {
+    ::operator delete(block);
+  }
+  m_overflow.clear();
+  // doubling keeps the number of frames spent growing small while the scene is still filling up
+  size_t capacity = std::max<size_t>(m_stats.capacity, 1);
+  while(capacity < m_stats.peak)
+  {
+    capacity *= 2;
+  }
+  ::operator delete(m_block);
+  m_block = static_cast<char *>(::operator new(capacity));
+  m_stats.capacity = capacity;
+}
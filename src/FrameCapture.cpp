@@ -0,0 +1,277 @@
+#include "FrameCapture.h"
+#include <QDir>
+#include <QImage>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+FrameCapture::~FrameCapture()
+{
+  stop();
+}
+
+bool FrameCapture::start(const std::string &_directory, Format _format, int _width, int _height)
+{
+  stop();
+  if(!QDir().mkpath(QString::fromStdString(_directory)))
+  {
+    std::cerr<<"FrameCapture unable to create "<<_directory<<"\n";
+    return false;
+  }
+  m_directory = _directory;
+  m_format = _format;
+  m_width = _width;
+  m_height = _height;
+  m_next = 0;
+  m_frame = 0;
+  m_captured = 0;
+  m_dropped = 0;
+  m_written.store(0, std::memory_order_relaxed);
+  m_running = true;
+  m_thread = std::thread(&FrameCapture::encode, this);
+  m_enabled = true;
+  std::cout<<"FrameCapture writing to "<<_directory<<"\n";
+  return true;
+}
+
+void FrameCapture::stop()
+{
+  if(!m_enabled)
+  {
+    return;
+  }
+  m_enabled = false;
+  if(m_created)
+  {
+    collect(true);
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_running = false;
+  }
+  m_wake.notify_one();
+  m_thread.join();
+  release();
+  std::cout<<"FrameCapture wrote "<<m_written.load(std::memory_order_relaxed)<<" frames to "<<m_directory
+           <<", dropped "<<m_dropped<<"\n";
+}
+
+void FrameCapture::create()
+{
+  const GLsizeiptr bytes = static_cast<GLsizeiptr>(m_width)*m_height*4;
+  // read back persistently mapped, once a fence has signalled the encoder reads the pixels in place
+  const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  for(auto &slot : m_slots)
+  {
+    glGenBuffers(1, &slot.buffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    glBufferStorage(GL_PIXEL_PACK_BUFFER, bytes, nullptr, flags);
+    slot.data = static_cast<const unsigned char *>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, flags));
+    slot.state.store(Free, std::memory_order_relaxed);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  glGenRenderbuffers(1, &m_colour);
+  glBindRenderbuffer(GL_RENDERBUFFER, m_colour);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, m_width, m_height);
+  glGenFramebuffers(1, &m_fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colour);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+  m_created = true;
+}
+
+void FrameCapture::release()
+{
+  if(!m_created)
+  {
+    return;
+  }
+  for(auto &slot : m_slots)
+  {
+    glDeleteBuffers(1, &slot.buffer);
+    slot.buffer = 0;
+    slot.data = nullptr;
+  }
+  glDeleteFramebuffers(1, &m_fbo);
+  glDeleteRenderbuffers(1, &m_colour);
+  glDeleteFramebuffers(1, &m_resolveFbo);
+  glDeleteRenderbuffers(1, &m_resolveColour);
+  m_fbo = m_colour = m_resolveFbo = m_resolveColour = 0;
+  m_resolveWidth = m_resolveHeight = 0;
+  m_created = false;
+}
+
+void FrameCapture::capture(GLuint _framebuffer, int _width, int _height)
+{
+  if(!m_enabled || _width <= 0 || _height <= 0)
+  {
+    return;
+  }
+  if(!m_created)
+  {
+    // the size is fixed for the whole sequence, later frames of a different size are scaled to it
+    if(m_width <= 0 || m_height <= 0)
+    {
+      m_width = _width;
+      m_height = _height;
+    }
+    create();
+  }
+  collect(false);
+  ++m_frame;
+  Slot &slot = m_slots[m_next];
+  if(slot.state.load(std::memory_order_acquire) != Free)
+  {
+    ++m_dropped;
+    return;
+  }
+
+  glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+  GLint samples = 0;
+  glGetIntegerv(GL_SAMPLES, &samples);
+  const GLenum readBuffer = _framebuffer == 0 ? GL_BACK : GL_COLOR_ATTACHMENT0;
+  const bool scaled = _width != m_width || _height != m_height;
+  if(samples > 0 && scaled)
+  {
+    if(m_resolveWidth != _width || m_resolveHeight != _height)
+    {
+      if(m_resolveFbo == 0)
+      {
+        glGenFramebuffers(1, &m_resolveFbo);
+        glGenRenderbuffers(1, &m_resolveColour);
+      }
+      glBindRenderbuffer(GL_RENDERBUFFER, m_resolveColour);
+      glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, _width, _height);
+      glBindRenderbuffer(GL_RENDERBUFFER, 0);
+      glBindFramebuffer(GL_FRAMEBUFFER, m_resolveFbo);
+      glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_resolveColour);
+      m_resolveWidth = _width;
+      m_resolveHeight = _height;
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, _framebuffer);
+    glReadBuffer(readBuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_resolveFbo);
+    glBlitFramebuffer(0, 0, _width, _height, 0, 0, _width, _height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_resolveFbo);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+  }
+  else
+  {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, _framebuffer);
+    glReadBuffer(readBuffer);
+  }
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo);
+  glBlitFramebuffer(0, 0, _width, _height, 0, 0, m_width, m_height, GL_COLOR_BUFFER_BIT, scaled ? GL_LINEAR : GL_NEAREST);
+
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, m_fbo);
+  glReadBuffer(GL_COLOR_ATTACHMENT0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+  glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  slot.frame = m_frame;
+  slot.state.store(Reading, std::memory_order_relaxed);
+  m_next = (m_next+1)%Slots;
+  ++m_captured;
+  glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer);
+}
+
+void FrameCapture::collect(bool _wait)
+{
+  // slots are filled in ring order so they are handed over in frame order
+  for(uint32_t i = 0; i < Slots; ++i)
+  {
+    Slot &slot = m_slots[(m_next+i)%Slots];
+    if(slot.state.load(std::memory_order_relaxed) != Reading)
+    {
+      continue;
+    }
+    const GLuint64 timeout = _wait ? 1000000000ull : 0;
+    GLenum result = glClientWaitSync(slot.fence, _wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, timeout);
+    if(result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+    {
+      if(!_wait)
+      {
+        break;
+      }
+      // the GPU never finished, give up on the frame rather than hang
+      glDeleteSync(slot.fence);
+      slot.fence = nullptr;
+      slot.state.store(Free, std::memory_order_release);
+      ++m_dropped;
+      continue;
+    }
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+    slot.state.store(Encoding, std::memory_order_release);
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_queue.push_back(static_cast<uint32_t>(&slot-m_slots));
+    }
+    m_wake.notify_one();
+  }
+}
+
+void FrameCapture::encode()
+{
+  for(;;)
+  {
+    uint32_t index;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_wake.wait(lock, [this]{ return !m_queue.empty() || !m_running; });
+      if(m_queue.empty())
+      {
+        return;
+      }
+      index = m_queue.front();
+      m_queue.pop_front();
+    }
+    write(m_slots[index]);
+    m_written.fetch_add(1, std::memory_order_relaxed);
+    m_slots[index].state.store(Free, std::memory_order_release);
+  }
+}
+
+void FrameCapture::write(const Slot &_slot)
+{
+  char name[48];
+  std::snprintf(name, sizeof(name), "/frame_%06llu.%s", static_cast<unsigned long long>(_slot.frame),
+                m_format == Format::Png ? "png" : "rgba");
+  const std::string path = m_directory+name;
+  if(m_format == Format::Png)
+  {
+    // GL rows start at the bottom, the copy made by mirrored() leaves the mapped buffer untouched
+    QImage image(_slot.data, m_width, m_height, m_width*4, QImage::Format_RGBA8888);
+    if(!image.mirrored().save(QString::fromStdString(path), "PNG"))
+    {
+      std::cerr<<"FrameCapture unable to write "<<path<<"\n";
+    }
+  }
+  else
+  {
+    std::ofstream file(path, std::ios::out | std::ios::binary);
+    file.write(reinterpret_cast<const char *>(_slot.data), static_cast<std::streamsize>(m_width)*m_height*4);
+    if(!file)
+    {
+      std::cerr<<"FrameCapture unable to write "<<path<<"\n";
+    }
+  }
+}
+
+FrameCapture::Counters FrameCapture::counters() const
+{
+  Counters counters;
+  counters.captured = m_captured;
+  counters.written = m_written.load(std::memory_order_relaxed);
+  counters.dropped = m_dropped;
+  for(const auto &slot : m_slots)
+  {
+    if(slot.state.load(std::memory_order_relaxed) != Free)
+    {
+      ++counters.queued;
+    }
+  }
+  return counters;
+}
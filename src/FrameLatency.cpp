@@ -0,0 +1,30 @@
+#include "FrameLatency.h"
+#include <algorithm>
+
+constexpr size_t FrameLatency::Window;
+
+void FrameLatency::add(double _ms)
+{
+  m_window[m_samples%Window] = _ms;
+  ++m_samples;
+  m_latest = _ms;
+  m_max = std::max(m_max, _ms);
+}
+
+FrameLatency::Summary FrameLatency::summary() const
+{
+  Summary summary;
+  summary.samples = m_samples;
+  summary.max = m_max;
+  const size_t count = static_cast<size_t>(std::min<uint64_t>(m_samples, Window));
+  if(count == 0)
+  {
+    return summary;
+  }
+  double sorted[Window];
+  std::copy(m_window, m_window+count, sorted);
+  std::sort(sorted, sorted+count);
+  summary.median = sorted[count/2];
+  summary.p99 = sorted[std::min(count-1, (count*99)/100)];
+  return summary;
+}
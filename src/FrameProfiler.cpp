@@ -0,0 +1,197 @@
+#include "FrameProfiler.h"
+#include <cstdio>
+#include <iostream>
+
+FrameProfiler::~FrameProfiler()
+{
+  stopLog();
+  if(m_created)
+  {
+    for(auto &slot : m_slots)
+    {
+      glDeleteQueries(StageCount+1, slot.queries);
+    }
+  }
+}
+
+const char *FrameProfiler::stageName(Stage _stage)
+{
+  static const char *names[StageCount] = { "clear", "prepare", "upload", "draw" };
+  return _stage < StageCount ? names[_stage] : "";
+}
+
+void FrameProfiler::setEnabled(bool _enabled)
+{
+  if(_enabled && !m_created)
+  {
+    for(auto &slot : m_slots)
+    {
+      glGenQueries(StageCount+1, slot.queries);
+    }
+    m_created = true;
+  }
+  if(!_enabled)
+  {
+    // anything in flight is stale by the time profiling starts again
+    for(auto &slot : m_slots)
+    {
+      slot.pending = false;
+    }
+    m_current = nullptr;
+  }
+  m_enabled = _enabled;
+}
+
+void FrameProfiler::beginFrame(uint64_t _frame)
+{
+  if(!m_enabled)
+  {
+    return;
+  }
+  Slot &slot = m_slots[_frame%Latency];
+  if(slot.pending)
+  {
+    collect(slot);
+  }
+  slot.sample = Sample();
+  slot.sample.frame = _frame;
+  m_current = &slot;
+  m_nextStage = 0;
+  glQueryCounter(slot.queries[0], GL_TIMESTAMP);
+  m_stageStart = Clock::now();
+}
+
+void FrameProfiler::mark(Stage _stage)
+{
+  if(m_current == nullptr || _stage != m_nextStage)
+  {
+    return;
+  }
+  const Clock::time_point now = Clock::now();
+  m_current->sample.cpuMs[_stage] = std::chrono::duration<double, std::milli>(now-m_stageStart).count();
+  m_current->sample.cpuTotalMs += m_current->sample.cpuMs[_stage];
+  m_stageStart = now;
+  glQueryCounter(m_current->queries[_stage+1], GL_TIMESTAMP);
+  ++m_nextStage;
+}
+
+void FrameProfiler::endFrame(uint32_t _drawCalls, uint64_t _triangles)
+{
+  if(m_current == nullptr)
+  {
+    return;
+  }
+  // a frame that skipped a stage (an early return) leaves its later timestamps unwritten
+  m_current->pending = m_nextStage == StageCount;
+  m_current->sample.drawCalls = _drawCalls;
+  m_current->sample.triangles = _triangles;
+  m_current = nullptr;
+}
+
+void FrameProfiler::collect(Slot &_slot)
+{
+  _slot.pending = false;
+  // the last timestamp is the last to complete, if it is ready they all are
+  GLint available = GL_FALSE;
+  glGetQueryObjectiv(_slot.queries[StageCount], GL_QUERY_RESULT_AVAILABLE, &available);
+  if(available != GL_TRUE)
+  {
+    ++m_dropped;
+    return;
+  }
+  GLuint64 stamps[StageCount+1];
+  for(uint32_t i = 0; i <= StageCount; ++i)
+  {
+    glGetQueryObjectui64v(_slot.queries[i], GL_QUERY_RESULT, &stamps[i]);
+  }
+  for(uint32_t i = 0; i < StageCount; ++i)
+  {
+    _slot.sample.gpuMs[i] = static_cast<double>(stamps[i+1]-stamps[i])*1.0e-6;
+  }
+  _slot.sample.gpuTotalMs = static_cast<double>(stamps[StageCount]-stamps[0])*1.0e-6;
+  m_latest = _slot.sample;
+  if(m_log.is_open())
+  {
+    write(m_latest);
+  }
+}
+
+bool FrameProfiler::startLog(const std::string &_path)
+{
+  stopLog();
+  m_logPath = _path;
+  m_csv = _path.size() > 4 && _path.compare(_path.size()-4, 4, ".csv") == 0;
+  if(!openLog())
+  {
+    return false;
+  }
+  setEnabled(true);
+  std::cout<<"FrameProfiler writing to "<<_path<<"\n";
+  return true;
+}
+
+void FrameProfiler::stopLog()
+{
+  if(m_log.is_open())
+  {
+    m_log.close();
+  }
+}
+
+bool FrameProfiler::openLog()
+{
+  m_log.open(m_logPath, std::ios::out | std::ios::trunc);
+  if(!m_log.is_open())
+  {
+    std::cerr<<"FrameProfiler unable to open "<<m_logPath<<"\n";
+    return false;
+  }
+  m_logRows = 0;
+  if(m_csv)
+  {
+    m_log<<"frame";
+    for(uint32_t i = 0; i < StageCount; ++i)
+    {
+      m_log<<",cpu_"<<stageName(static_cast<Stage>(i))<<"_ms,gpu_"<<stageName(static_cast<Stage>(i))<<"_ms";
+    }
+    m_log<<",cpu_ms,gpu_ms,draw_calls,triangles\n";
+  }
+  return true;
+}
+
+void FrameProfiler::write(const Sample &_sample)
+{
+  if(m_logRows == LogRows)
+  {
+    // keep one previous generation so a reader tailing the file never loses more than it
+    m_log.close();
+    const std::string previous = m_logPath+".1";
+    std::remove(previous.c_str());
+    std::rename(m_logPath.c_str(), previous.c_str());
+    if(!openLog())
+    {
+      return;
+    }
+  }
+  if(m_csv)
+  {
+    m_log<<_sample.frame;
+    for(uint32_t i = 0; i < StageCount; ++i)
+    {
+      m_log<<","<<_sample.cpuMs[i]<<","<<_sample.gpuMs[i];
+    }
+    m_log<<","<<_sample.cpuTotalMs<<","<<_sample.gpuTotalMs<<","<<_sample.drawCalls<<","<<_sample.triangles<<"\n";
+  }
+  else
+  {
+    m_log<<"{\"frame\":"<<_sample.frame;
+    for(uint32_t i = 0; i < StageCount; ++i)
+    {
+      const char *name = stageName(static_cast<Stage>(i));
+      m_log<<",\"cpu_"<<name<<"_ms\":"<<_sample.cpuMs[i]<<",\"gpu_"<<name<<"_ms\":"<<_sample.gpuMs[i];
+    }
+    m_log<<",\"cpu_ms\":"<<_sample.cpuTotalMs<<",\"gpu_ms\":"<<_sample.gpuTotalMs
+         <<",\"draw_calls\":"<<_sample.drawCalls<<",\"triangles\":"<<_sample.triangles<<"}\n";
+  }
+  ++m_logRows;
+}
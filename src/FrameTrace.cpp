@@ -0,0 +1,109 @@
+#include "FrameTrace.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+FrameTrace::~FrameTrace()
+{
+  stop();
+}
+
+bool FrameTrace::start(const std::string &_path, size_t _capacity)
+{
+  stop();
+  m_binary = _path.size() > 4 && _path.compare(_path.size()-4, 4, ".bin") == 0;
+  m_file.open(_path, m_binary ? std::ios::out | std::ios::binary : std::ios::out);
+  if(!m_file.is_open())
+  {
+    std::cerr<<"FrameTrace unable to open "<<_path<<"\n";
+    return false;
+  }
+  size_t capacity = 1;
+  while(capacity < _capacity)
+  {
+    capacity <<= 1;
+  }
+  m_ring.resize(capacity);
+  m_mask = capacity-1;
+  m_head.store(0, std::memory_order_relaxed);
+  m_tail.store(0, std::memory_order_relaxed);
+  m_dropped.store(0, std::memory_order_relaxed);
+  m_running.store(true, std::memory_order_release);
+  m_thread = std::thread(&FrameTrace::drain, this);
+  m_enabled.store(true, std::memory_order_release);
+  std::cout<<"FrameTrace writing to "<<_path<<"\n";
+  return true;
+}
+
+void FrameTrace::stop()
+{
+  if(!m_running.load(std::memory_order_acquire))
+  {
+    return;
+  }
+  m_enabled.store(false, std::memory_order_release);
+  m_running.store(false, std::memory_order_release);
+  m_thread.join();
+  m_file.close();
+  if(dropped() != 0)
+  {
+    std::cerr<<"FrameTrace dropped "<<dropped()<<" records\n";
+  }
+}
+
+void FrameTrace::record(uint64_t _frame, uint32_t _cell, const ngl::Mat4 &_mvp, const ngl::Vec4 &_colour)
+{
+  size_t head = m_head.load(std::memory_order_relaxed);
+  if(head - m_tail.load(std::memory_order_acquire) > m_mask)
+  {
+    m_dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  Record &r = m_ring[head & m_mask];
+  r.frame = _frame;
+  r.cell = _cell;
+  std::memcpy(r.mvp, _mvp.openGL(), sizeof(r.mvp));
+  std::memcpy(r.colour, _colour.openGL(), sizeof(r.colour));
+  m_head.store(head+1, std::memory_order_release);
+}
+
+void FrameTrace::drain()
+{
+  while(m_running.load(std::memory_order_acquire))
+  {
+    if(flush() == 0)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  // the producer has stopped so pick up anything pushed before the flag changed
+  flush();
+  m_file.flush();
+}
+
+size_t FrameTrace::flush()
+{
+  size_t tail = m_tail.load(std::memory_order_relaxed);
+  size_t head = m_head.load(std::memory_order_acquire);
+  for(size_t i = tail; i != head; ++i)
+  {
+    write(m_ring[i & m_mask]);
+  }
+  m_tail.store(head, std::memory_order_release);
+  return head-tail;
+}
+
+void FrameTrace::write(const Record &_r)
+{
+  if(m_binary)
+  {
+    m_file.write(reinterpret_cast<const char *>(&_r), sizeof(Record));
+    return;
+  }
+  m_file<<"{\"frame\":"<<_r.frame<<",\"cell\":"<<_r.cell<<",\"mvp\":[";
+  for(int i = 0; i < 16; ++i)
+  {
+    m_file<<(i ? "," : "")<<_r.mvp[i];
+  }
+  m_file<<"],\"colour\":["<<_r.colour[0]<<','<<_r.colour[1]<<','<<_r.colour[2]<<','<<_r.colour[3]<<"]}\n";
+}
@@ -0,0 +1,48 @@
+#include "Frustum.h"
+#include <cmath>
+
+Frustum::Frustum(const ngl::Mat4 &_clip)
+{
+  // the matrix is column major so row i is m[i], m[4+i], m[8+i], m[12+i]
+  const float *m = _clip.openGL();
+  for(int i = 0; i < 3; ++i)
+  {
+    for(int c = 0; c < 4; ++c)
+    {
+      m_planes[i*2][c]   = m[c*4+3]+m[c*4+i];
+      m_planes[i*2+1][c] = m[c*4+3]-m[c*4+i];
+    }
+  }
+  for(float *p : m_planes)
+  {
+    float length = std::sqrt(p[0]*p[0]+p[1]*p[1]+p[2]*p[2]);
+    for(int c = 0; c < 4; ++c)
+    {
+      p[c] /= length;
+    }
+  }
+}
+
+Frustum::Result Frustum::test(const float *_min, const float *_max) const
+{
+  Result result = Result::Inside;
+  for(const float *p : m_planes)
+  {
+    // the corners furthest along and against the plane normal
+    float far = p[3], near = p[3];
+    for(int c = 0; c < 3; ++c)
+    {
+      far  += p[c]*(p[c] >= 0.0f ? _max[c] : _min[c]);
+      near += p[c]*(p[c] >= 0.0f ? _min[c] : _max[c]);
+    }
+    if(far < 0.0f)
+    {
+      return Result::Outside;
+    }
+    if(near < 0.0f)
+    {
+      result = Result::Intersect;
+    }
+  }
+  return result;
+}
@@ -0,0 +1,439 @@
+/****************************************************************************
+offscreen benchmark for the grid renderer, renders into an FBO on a
+QOffscreenSurface so it runs without a window (including Mesa llvmpipe)
+****************************************************************************/
+#include <QtGui/QGuiApplication>
+#include <QCommandLineParser>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QSurfaceFormat>
+#include "GridRenderer.h"
+#include "GridKernel.h"
+#include "FrameCapture.h"
+#include "AllocationCounter.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+  struct Summary
+  {
+    double min=0.0;
+    double median=0.0;
+    double p99=0.0;
+  };
+
+  Summary summarise(std::vector<double> _samples)
+  {
+    Summary s;
+    if(_samples.empty())
+    {
+      return s;
+    }
+    std::sort(_samples.begin(), _samples.end());
+    s.min = _samples.front();
+    s.median = _samples[_samples.size()/2];
+    s.p99 = _samples[std::min(_samples.size()-1, (_samples.size()*99)/100)];
+    return s;
+  }
+
+  void writeSummary(std::ostream &_out, const char *_name, const Summary &_s)
+  {
+    _out<<"\""<<_name<<"\":{\"min\":"<<_s.min<<",\"median\":"<<_s.median<<",\"p99\":"<<_s.p99<<"}";
+  }
+
+  std::vector<float> parseList(const QString &_list)
+  {
+    std::vector<float> values;
+    QStringList items = _list.split(",");
+    for(int i = 0; i < items.size(); ++i)
+    {
+      values.push_back(items[i].toFloat());
+    }
+    return values;
+  }
+
+  // false if any item is not a positive number, a zero step divides by zero in the streamer and picker
+  bool parsePositiveList(const QString &_list, std::vector<float> &o_values)
+  {
+    o_values.clear();
+    QStringList items = _list.split(",");
+    for(int i = 0; i < items.size(); ++i)
+    {
+      bool ok = false;
+      const float value = items[i].toFloat(&ok);
+      if(!ok || !std::isfinite(value) || value <= 0.0f)
+      {
+        return false;
+      }
+      o_values.push_back(value);
+    }
+    return true;
+  }
+
+  // largest kernel error we accept against ngl::Transformation, relative to the size of the grid
+  constexpr float KernelTolerance = 1.0e-5f;
+}
+
+int main(int argc, char **argv)
+{
+  QGuiApplication app(argc, argv);
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Offscreen benchmark for the NGL grid renderer, writes one JSON line per run");
+  parser.addHelpOption();
+  QCommandLineOption framesOption("frames", "measured frames per run", "n", "200");
+  QCommandLineOption warmupOption("warmup", "unmeasured frames before each run", "n", "20");
+  QCommandLineOption widthOption("width", "framebuffer width", "pixels", "1024");
+  QCommandLineOption heightOption("height", "framebuffer height", "pixels", "720");
+  QCommandLineOption farOption("far", "distance to the far clipping plane, the coarser levels of detail only start about 135 away at 720 pixels high", "units", "10");
+  QCommandLineOption cellsOption("cells", "comma separated cells along each side of the grid", "list", "80");
+  QCommandLineOption stepOption("step", "comma separated cell spacings", "list", "0.5");
+  QCommandLineOption modeOption("mode", "comma separated draw modes, instanced, perdraw, procedural, streamed and / or mixed", "list", "instanced,perdraw");
+  QCommandLineOption cullOption("cull", "comma separated cull modes, none, cpu and / or gpu", "list", "none,cpu,gpu");
+  QCommandLineOption lodOption("lod", "comma separated level of detail settings, off and / or on", "list", "off,on");
+  QCommandLineOption occlusionOption("occlusion", "comma separated occlusion culling settings, off and / or on, only used by instanced with gpu culling", "list", "off");
+  QCommandLineOption threadsOption("threads", "comma separated frame preparation thread counts, 0 for one per core", "list", "0");
+  QCommandLineOption rebuildOption("rebuild", "rebuild the per cell data every frame to time the parallel build");
+  QCommandLineOption verifyOption("verify", "check the SIMD transform kernel against ngl::Transformation for each grid and fail on mismatch");
+  QCommandLineOption profileOption("profile", "per frame stage timings for every run, .csv gives CSV else JSON lines", "file");
+  QCommandLineOption captureOption("capture", "record every measured frame into a directory as PNG", "directory");
+  QCommandLineOption panOption("pan", "move the camera along x every frame, to stream tiles in and out", "units", "0");
+  QCommandLineOption tileBudgetOption("tile-budget", "memory for the streamed tiles", "MB", "64");
+  QCommandLineOption outputOption("output", "results file, - for stdout (NGL also logs there)", "file", "grid_benchmark.jsonl");
+  parser.addOption(framesOption);
+  parser.addOption(warmupOption);
+  parser.addOption(widthOption);
+  parser.addOption(heightOption);
+  parser.addOption(farOption);
+  parser.addOption(cellsOption);
+  parser.addOption(stepOption);
+  parser.addOption(modeOption);
+  parser.addOption(cullOption);
+  parser.addOption(lodOption);
+  parser.addOption(occlusionOption);
+  parser.addOption(threadsOption);
+  parser.addOption(rebuildOption);
+  parser.addOption(verifyOption);
+  parser.addOption(profileOption);
+  parser.addOption(captureOption);
+  parser.addOption(panOption);
+  parser.addOption(tileBudgetOption);
+  parser.addOption(outputOption);
+  parser.process(app);
+
+  const int frames = std::max(1, parser.value(framesOption).toInt());
+  const int warmup = parser.value(warmupOption).toInt();
+  const int width = parser.value(widthOption).toInt();
+  const int height = parser.value(heightOption).toInt();
+  const std::vector<float> cellCounts = parseList(parser.value(cellsOption));
+  const std::vector<float> threadCounts = parseList(parser.value(threadsOption));
+  const bool rebuild = parser.isSet(rebuildOption);
+  const bool verify = parser.isSet(verifyOption);
+  std::vector<float> steps;
+  if(!parsePositiveList(parser.value(stepOption), steps))
+  {
+    std::cerr<<"--step must be a list of positive numbers, not \""<<parser.value(stepOption).toStdString()<<"\"\n";
+    return EXIT_FAILURE;
+  }
+  std::vector<float> farPlane;
+  if(!parsePositiveList(parser.value(farOption), farPlane) || farPlane.size() != 1)
+  {
+    std::cerr<<"--far must be a positive number, not \""<<parser.value(farOption).toStdString()<<"\"\n";
+    return EXIT_FAILURE;
+  }
+  const QStringList modes = parser.value(modeOption).split(",");
+  const QStringList culls = parser.value(cullOption).split(",");
+  const QStringList lods = parser.value(lodOption).split(",");
+  const QStringList occlusions = parser.value(occlusionOption).split(",");
+  const float pan = parser.value(panOption).toFloat();
+
+  // same format as the windowed app but no multisampling as the FBO is single sampled
+  QSurfaceFormat format;
+  format.setMajorVersion(4);
+  format.setMinorVersion(3);
+  format.setProfile(QSurfaceFormat::CoreProfile);
+  format.setDepthBufferSize(24);
+
+  QOpenGLContext context;
+  context.setFormat(format);
+  if(!context.create())
+  {
+    std::cerr<<"unable to create a GL 4.3 core context\n";
+    return EXIT_FAILURE;
+  }
+  QOffscreenSurface surface;
+  surface.setFormat(context.format());
+  surface.create();
+  if(!context.makeCurrent(&surface))
+  {
+    std::cerr<<"unable to make the offscreen context current\n";
+    return EXIT_FAILURE;
+  }
+
+  std::ofstream file;
+  const bool toStdout = parser.value(outputOption) == "-";
+  if(!toStdout)
+  {
+    file.open(parser.value(outputOption).toStdString());
+    if(!file.is_open())
+    {
+      std::cerr<<"unable to open "<<parser.value(outputOption).toStdString()<<" for the results\n";
+      return EXIT_FAILURE;
+    }
+  }
+  std::ostream &out = toStdout ? std::cout : file;
+
+  QOpenGLFramebufferObjectFormat fboFormat;
+  fboFormat.setAttachment(QOpenGLFramebufferObject::Depth);
+  {
+    QOpenGLFramebufferObject fbo(width, height, fboFormat);
+    fbo.bind();
+
+    GridRenderer renderer;
+    renderer.initialize();
+    renderer.resize(width, height);
+    renderer.setFarPlane(farPlane.front());
+    renderer.setTileBudget(static_cast<size_t>(std::max(1, parser.value(tileBudgetOption).toInt())) << 20);
+    if(parser.isSet(profileOption))
+    {
+      renderer.profiler().startLog(parser.value(profileOption).toStdString());
+    }
+    FrameCapture capture;
+    if(parser.isSet(captureOption))
+    {
+      capture.start(parser.value(captureOption).toStdString());
+    }
+    // default view, no mouse rotation, only the --pan translation
+    ngl::Mat4 mouseRotation;
+
+    std::vector<GLuint> queries(static_cast<size_t>(frames));
+    glGenQueries(frames, queries.data());
+    std::vector<double> cpu;
+    std::vector<double> prepare;
+    std::vector<double> fenceWait;
+    std::vector<double> gpu;
+    std::vector<double> drawCalls;
+    std::vector<double> instances;
+    std::vector<double> culled;
+    std::vector<double> occluded;
+    std::vector<double> vertices;
+    std::vector<double> tilesMissing;
+    std::vector<double> pick;
+    std::vector<double> unsortedChanges;
+    std::vector<double> sortedChanges;
+    std::vector<double> sorting;
+    std::vector<double> allocations;
+    std::vector<double> allocatedBytes;
+
+    for(float threads : threadCounts)
+    {
+      renderer.setThreadCount(static_cast<unsigned int>(std::max(0.0f, threads)));
+      for(int m = 0; m < modes.size(); ++m)
+      {
+        const std::string mode = modes[m].toStdString();
+        renderer.setDrawMode(mode == "perdraw" ? GridRenderer::DrawMode::PerDraw :
+                             mode == "procedural" ? GridRenderer::DrawMode::Procedural :
+                             mode == "streamed" ? GridRenderer::DrawMode::Streamed :
+                             mode == "mixed" ? GridRenderer::DrawMode::Mixed : GridRenderer::DrawMode::Instanced);
+        for(int c = 0; c < culls.size(); ++c)
+        {
+          const QString cull = culls[c];
+          renderer.setCullMode(cull == "gpu" ? GridRenderer::CullMode::Gpu :
+                               cull == "cpu" ? GridRenderer::CullMode::Cpu : GridRenderer::CullMode::None);
+          for(int l = 0; l < lods.size(); ++l)
+          {
+            const bool lod = lods[l] == "on";
+            renderer.setLod(lod);
+            for(int o = 0; o < occlusions.size(); ++o)
+            {
+              const bool occlusion = occlusions[o] == "on";
+              renderer.setOcclusion(occlusion);
+              for(float cells : cellCounts)
+              {
+                for(float step : steps)
+                {
+                  GridConfig grid;
+                  grid.cellsX = grid.cellsZ = static_cast<uint32_t>(std::max(1.0f, cells));
+                  grid.step = step;
+                  renderer.setGrid(grid);
+
+                  float kernelError = 0.0f;
+                  if(verify)
+                  {
+                    ngl::Mat4 prefix;
+                    prefix.rotateY(30.0f);
+                    kernelError = GridKernel::verify(grid, prefix);
+                    float limit = KernelTolerance*std::max(1.0f, 0.5f*step*grid.cellsX);
+                    if(kernelError > limit)
+                    {
+                      std::cerr<<"GridKernel ("<<GridKernel::name()<<") differs from ngl::Transformation by "
+                               <<kernelError<<" for "<<grid.cellsX<<" cells, step "<<step<<"\n";
+                      return EXIT_FAILURE;
+                    }
+                  }
+
+                  // every run starts over the origin so streamed runs see the same tiles
+                  mouseRotation.m_m[3][0] = 0.0f;
+                  for(int i = 0; i < warmup; ++i)
+                  {
+                    mouseRotation.m_m[3][0] -= pan;
+                    renderer.render(mouseRotation);
+                  }
+                  glFinish();
+
+                  cpu.clear();
+                  prepare.clear();
+                  fenceWait.clear();
+                  uint64_t fenceWaits = 0;
+                  const FrameCapture::Counters captureBefore = capture.counters();
+                  gpu.clear();
+                  drawCalls.clear();
+                  instances.clear();
+                  culled.clear();
+                  occluded.clear();
+                  vertices.clear();
+                  tilesMissing.clear();
+                  pick.clear();
+                  unsortedChanges.clear();
+                  sortedChanges.clear();
+                  sorting.clear();
+                  allocations.clear();
+                  allocatedBytes.clear();
+                  // a frame of a steady run that allocates fails the benchmark, rebuilding, panning, capturing and
+                  // logging all allocate by design and a streamed frame is let off while its tiles arrive
+                  const bool steady = !rebuild && pan == 0.0f && !parser.isSet(captureOption) && !parser.isSet(profileOption);
+                  int steadyFailures = 0;
+                  const uint64_t evictedBefore = renderer.streamer().stats().evicted;
+                  for(int i = 0; i < frames; ++i)
+                  {
+                    mouseRotation.m_m[3][0] -= pan;
+                    if(rebuild)
+                    {
+                      renderer.invalidateGrid();
+                    }
+                    const AllocationCounter::Counts allocatedBefore = AllocationCounter::counts();
+                    auto start = std::chrono::steady_clock::now();
+                    glBeginQuery(GL_TIME_ELAPSED, queries[static_cast<size_t>(i)]);
+                    renderer.render(mouseRotation);
+                    glEndQuery(GL_TIME_ELAPSED);
+                    // the readback is queued inside the CPU timing so any stall it caused would show
+                    capture.capture(fbo.handle(), width, height);
+                    auto end = std::chrono::steady_clock::now();
+                    const AllocationCounter::Counts allocatedAfter = AllocationCounter::counts();
+                    const uint64_t frameAllocations = allocatedAfter.allocations-allocatedBefore.allocations;
+                    const TileStreamer::Stats &streamed = renderer.streamer().stats();
+                    const bool streaming = mode == "streamed" && (streamed.queued != 0 || streamed.uploaded != 0);
+                    if(steady && !streaming && frameAllocations != 0)
+                    {
+                      ++steadyFailures;
+                    }
+                    allocations.push_back(static_cast<double>(frameAllocations));
+                    allocatedBytes.push_back(static_cast<double>(allocatedAfter.bytes-allocatedBefore.bytes));
+                    cpu.push_back(std::chrono::duration<double, std::milli>(end-start).count());
+                    drawCalls.push_back(renderer.stats().drawCalls);
+                    prepare.push_back(renderer.stats().prepareMs);
+                    fenceWait.push_back(renderer.stats().fenceWaitMs);
+                    fenceWaits += renderer.stats().fenceWaits;
+                    instances.push_back(renderer.stats().instances);
+                    culled.push_back(renderer.stats().culled);
+                    occluded.push_back(renderer.stats().occluded);
+                    vertices.push_back(static_cast<double>(renderer.stats().vertices));
+                    tilesMissing.push_back(renderer.streamer().stats().missing);
+                    unsortedChanges.push_back(renderer.stats().unsortedChanges.total());
+                    sortedChanges.push_back(renderer.stats().sortedChanges.total());
+                    sorting.push_back(renderer.stats().sortMs);
+                    // outside the frame timing, a pixel sweeping the diagonal of the framebuffer
+                    const float along = static_cast<float>(i)/frames;
+                    pick.push_back(renderer.pick(along*width, along*height, mouseRotation).micros);
+                  }
+                  // results are only read once the run is over so the queries never stall the loop
+                  glFinish();
+                  for(GLuint query : queries)
+                  {
+                    GLuint64 ns = 0;
+                    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+                    gpu.push_back(static_cast<double>(ns)*1.0e-6);
+                  }
+
+                  out<<"{\"mode\":\""<<mode<<"\""
+                     <<",\"cells_x\":"<<grid.cellsX<<",\"cells_z\":"<<grid.cellsZ<<",\"step\":"<<step
+                     <<",\"cull\":\""<<cull.toStdString()<<"\""
+                     <<",\"lod\":"<<(lod ? "true" : "false")
+                     <<",\"occlusion\":"<<(occlusion ? "true" : "false")
+                     <<",\"cells\":"<<grid.cellCount()
+                     <<",\"kernel\":\""<<GridKernel::name()<<"\",\"kernel_error\":"<<kernelError
+                     <<",\"threads\":"<<renderer.threadCount()<<",\"rebuild\":"<<(rebuild ? "true" : "false")
+                     <<",\"program_cache_hits\":"<<renderer.programStats().hits
+                     <<",\"program_cache_misses\":"<<renderer.programStats().misses
+                     <<",\"program_build_ms\":"<<renderer.programStats().loadMs+renderer.programStats().compileMs
+                     <<",\"captured\":"<<capture.counters().captured-captureBefore.captured
+                     <<",\"capture_dropped\":"<<capture.counters().dropped-captureBefore.dropped
+                     <<",\"far\":"<<renderer.farPlane()<<",\"pan\":"<<pan<<",\"tile_budget_mb\":"<<(renderer.streamer().budget() >> 20)
+                     <<",\"tiles_evicted\":"<<renderer.streamer().stats().evicted-evictedBefore
+                     <<",\"steady_frames_allocating\":"<<steadyFailures
+                     <<",\"fence_waits\":"<<fenceWaits<<",\"width\":"<<width<<",\"height\":"<<height<<",\"frames\":"<<frames<<",";
+                  writeSummary(out, "cpu_ms", summarise(cpu));
+                  out<<",";
+                  writeSummary(out, "prepare_ms", summarise(prepare));
+                  out<<",";
+                  writeSummary(out, "fence_wait_ms", summarise(fenceWait));
+                  out<<",";
+                  writeSummary(out, "gpu_ms", summarise(gpu));
+                  out<<",";
+                  writeSummary(out, "draw_calls", summarise(drawCalls));
+                  out<<",";
+                  writeSummary(out, "instances", summarise(instances));
+                  out<<",";
+                  writeSummary(out, "culled", summarise(culled));
+                  out<<",";
+                  writeSummary(out, "occluded", summarise(occluded));
+                  out<<",";
+                  writeSummary(out, "vertices", summarise(vertices));
+                  out<<",";
+                  writeSummary(out, "tiles_missing", summarise(tilesMissing));
+                  out<<",";
+                  writeSummary(out, "pick_us", summarise(pick));
+                  out<<",";
+                  writeSummary(out, "state_changes_unsorted", summarise(unsortedChanges));
+                  out<<",";
+                  writeSummary(out, "state_changes_sorted", summarise(sortedChanges));
+                  out<<",";
+                  writeSummary(out, "sort_ms", summarise(sorting));
+                  out<<",";
+                  writeSummary(out, "allocations", summarise(allocations));
+                  out<<",";
+                  writeSummary(out, "allocated_bytes", summarise(allocatedBytes));
+                  out<<"}\n";
+                  out.flush();
+                  if(steadyFailures != 0)
+                  {
+                    std::cerr<<steadyFailures<<" steady state frames allocated in mode "<<mode<<", cull "<<cull.toStdString()
+                             <<", lod "<<(lod ? "on" : "off")<<", "<<grid.cellsX<<" cells, step "<<step<<"\n";
+                    return EXIT_FAILURE;
+                  }
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+    glDeleteQueries(frames, queries.data());
+    capture.stop();
+    fbo.release();
+  }
+  context.doneCurrent();
+  // a full disk or closed pipe would otherwise pass with missing results
+  if(!out.good())
+  {
+    std::cerr<<"failed writing the results\n";
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,149 @@
+#include "GridCuller.h"
+
+void GridCuller::cull(const GridModel &_model, const ngl::Mat4 &_clip, const GridLod &_lod, JobSystem &_jobs, FrameArena &_arena, bool _frustum)
+{
+  const std::vector<GridModel::Tile> &tiles = _model.tiles();
+  m_stats = Stats();
+  for(std::vector<Command> &commands : m_commands)
+  {
+    commands.clear();
+  }
+  m_visibleCount = 0;
+  if(tiles.empty())
+  {
+    return;
+  }
+  // cheap next to the cull itself so redo it every frame rather than tracking grid rebuilds
+  const uint32_t levelCount = _lod.levelCount();
+  m_visibleTiles = _arena.allocate<VisibleTile>(tiles.size());
+  m_tileOffsets = _arena.allocate<uint32_t>(tiles.size());
+  m_tileCounts = _arena.allocate<uint32_t>(tiles.size());
+  uint32_t offset = 0;
+  for(size_t t = 0; t < tiles.size(); ++t)
+  {
+    m_tileOffsets[t] = offset;
+    offset += levelCount > 1 ? tiles[t].count() : tiles[t].h*((tiles[t].w+1)/2);
+  }
+  m_tileCommands = _arena.allocate<Command>(offset);
+  m_tileCommandLevels = _arena.allocate<uint8_t>(offset);
+  if(m_cellLevels.size() != _model.size())
+  {
+    m_cellLevels.assign(_model.size(), 0);
+  }
+
+  Frustum frustum(_clip);
+  if(_frustum)
+  {
+    gatherTiles(_model, frustum, 0, false);
+  }
+  else
+  {
+    for(uint32_t t = 0; t < tiles.size(); ++t)
+    {
+      m_visibleTiles[m_visibleCount++] = {t, true};
+    }
+  }
+
+  _jobs.parallelFor(0, m_visibleCount, 4, [&](size_t _begin, size_t _end)
+  {
+    for(size_t i = _begin; i < _end; ++i)
+    {
+      cullTile(_model, frustum, _lod, m_visibleTiles[i]);
+    }
+  });
+
+  // compact the per tile slices in tile order, one bucket per level
+  for(uint32_t v = 0; v < m_visibleCount; ++v)
+  {
+    const VisibleTile &visible = m_visibleTiles[v];
+    const uint32_t first = m_tileOffsets[visible.tile];
+    for(uint32_t c = first; c < first+m_tileCounts[visible.tile]; ++c)
+    {
+      const uint8_t level = m_tileCommandLevels[c];
+      m_stats.levels[level] += m_tileCommands[c].instanceCount;
+      m_commands[level].push_back(m_tileCommands[c]);
+    }
+  }
+  for(uint32_t level = 0; level < levelCount; ++level)
+  {
+    m_stats.visible += m_stats.levels[level];
+  }
+  m_stats.tilesVisible = m_visibleCount;
+  m_stats.tilesCulled = static_cast<uint32_t>(tiles.size())-m_stats.tilesVisible;
+  m_stats.culled = static_cast<uint32_t>(_model.size())-m_stats.visible;
+}
+
+void GridCuller::gatherTiles(const GridModel &_model, const Frustum &_frustum, uint32_t _node, bool _inside)
+{
+  const GridModel::Node &node = _model.nodes()[_node];
+  if(!_inside)
+  {
+    Frustum::Result result = _frustum.test(node.min, node.max);
+    if(result == Frustum::Result::Outside)
+    {
+      return;
+    }
+    // everything below a node that is fully inside is visible without further tests
+    _inside = result == Frustum::Result::Inside;
+  }
+  if(node.childCount == 0)
+  {
+    m_visibleTiles[m_visibleCount++] = {node.tile, _inside};
+    return;
+  }
+  for(uint32_t c = 0; c < node.childCount; ++c)
+  {
+    gatherTiles(_model, _frustum, node.firstChild+c, _inside);
+  }
+}
+
+void GridCuller::cullTile(const GridModel &_model, const Frustum &_frustum, const GridLod &_lod, const VisibleTile &_visible)
+{
+  const GridModel::Tile &tile = _model.tiles()[_visible.tile];
+  Command *out = &m_tileCommands[m_tileOffsets[_visible.tile]];
+  uint8_t *outLevels = &m_tileCommandLevels[m_tileOffsets[_visible.tile]];
+  uint32_t count = 0;
+  if(_visible.inside && _lod.levelCount() == 1)
+  {
+    outLevels[count] = 0;
+    out[count++] = { _lod.level(0).vertexCount, tile.count(), 0, tile.first };
+  }
+  else
+  {
+    const GridConfig &grid = _model.config();
+    const float radius = _model.cellRadius();
+    uint8_t *cellLevels = &m_cellLevels[tile.first];
+    for(uint32_t row = 0; row < tile.h; ++row)
+    {
+      const float z = grid.cellZ(tile.iz+row);
+      uint32_t runStart = 0;
+      // level of the current run, MaxLevels when not in a run
+      uint32_t runLevel = GridLod::MaxLevels;
+      for(uint32_t col = 0; col <= tile.w; ++col)
+      {
+        uint32_t level = GridLod::MaxLevels;
+        if(col < tile.w)
+        {
+          const float x = grid.cellX(tile.ix+col);
+          if(_visible.inside || _frustum.sphereVisible(x, 0.0f, z, radius))
+          {
+            uint8_t &cellLevel = cellLevels[row*tile.w+col];
+            cellLevel = static_cast<uint8_t>(_lod.select(_lod.pixels(x, 0.0f, z, radius), cellLevel));
+            level = cellLevel;
+          }
+        }
+        if(level != runLevel)
+        {
+          if(runLevel != GridLod::MaxLevels)
+          {
+            outLevels[count] = static_cast<uint8_t>(runLevel);
+            out[count++] = { _lod.level(runLevel).vertexCount, col-runStart, 0, tile.first+row*tile.w+runStart };
+          }
+          runStart = col;
+          runLevel = level;
+        }
+      }
+    }
+  }
+  m_tileCounts[_visible.tile] = count;
+}
@@ -0,0 +1,116 @@
+#include "GridKernel.h"
+#include <ngl/Transformation.h>
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+#if defined(__SSE__) && !defined(GRID_KERNEL_SCALAR)
+  #define GRID_KERNEL_SSE
+  #include <xmmintrin.h>
+#endif
+
+// the kernels treat a Mat4 as 16 floats in the column major order it is sent to GL in
+static_assert(sizeof(ngl::Mat4) == 16*sizeof(float), "ngl::Mat4 must be 16 packed floats");
+static_assert(sizeof(ngl::Vec4) == 4*sizeof(float), "ngl::Vec4 must be 4 packed floats");
+
+namespace GridKernel
+{
+
+void computeMatricesScalar(const GridConfig &_grid, const ngl::Mat4 &_prefix, size_t _begin, size_t _end, ngl::Mat4 *_out)
+{
+  const float *p = _prefix.openGL();
+  const float s = _grid.scale;
+  for(size_t cell = _begin; cell < _end; ++cell)
+  {
+    const float x = _grid.cellX(static_cast<uint32_t>(cell % _grid.cellsX));
+    const float z = _grid.cellZ(static_cast<uint32_t>(cell / _grid.cellsX));
+    float *m = _out[cell-_begin].m_openGL;
+    for(int row = 0; row < 4; ++row)
+    {
+      m[row]    = p[row]*s;
+      m[4+row]  = p[4+row]*s;
+      m[8+row]  = p[8+row]*s;
+      m[12+row] = p[row]*x + p[8+row]*z + p[12+row];
+    }
+  }
+}
+
+void computeMatrices(const GridConfig &_grid, const ngl::Mat4 &_prefix, size_t _begin, size_t _end, ngl::Mat4 *_out)
+{
+#ifdef GRID_KERNEL_SSE
+  const float *p = _prefix.openGL();
+  const __m128 c0 = _mm_loadu_ps(p);
+  const __m128 c2 = _mm_loadu_ps(p+8);
+  const __m128 c3 = _mm_loadu_ps(p+12);
+  const __m128 s = _mm_set1_ps(_grid.scale);
+  // the scaled axes are the same for every cell
+  const __m128 axisX = _mm_mul_ps(c0, s);
+  const __m128 axisY = _mm_mul_ps(_mm_loadu_ps(p+4), s);
+  const __m128 axisZ = _mm_mul_ps(c2, s);
+
+  uint32_t ix = static_cast<uint32_t>(_begin % _grid.cellsX);
+  uint32_t iz = static_cast<uint32_t>(_begin / _grid.cellsX);
+  // x and z only change once per row so hoist the z term
+  __m128 row = _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(_grid.cellZ(iz))), c3);
+  float *out = _out->m_openGL;
+  for(size_t cell = _begin; cell < _end; ++cell, out += 16)
+  {
+    const __m128 t = _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(_grid.cellX(ix))), row);
+    _mm_store_ps(out, axisX);
+    _mm_store_ps(out+4, axisY);
+    _mm_store_ps(out+8, axisZ);
+    _mm_store_ps(out+12, t);
+    if(++ix == _grid.cellsX)
+    {
+      ix = 0;
+      row = _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(_grid.cellZ(++iz))), c3);
+    }
+  }
+#else
+  computeMatricesScalar(_grid, _prefix, _begin, _end, _out);
+#endif
+}
+
+void computeColours(const GridConfig &_grid, size_t _begin, size_t _end, ngl::Vec4 *_out)
+{
+  for(size_t cell = _begin; cell < _end; ++cell)
+  {
+    const float x = _grid.cellX(static_cast<uint32_t>(cell % _grid.cellsX));
+    const float z = _grid.cellZ(static_cast<uint32_t>(cell / _grid.cellsX));
+    ngl::Vec4 colour(z,z,x,1.0f);
+    colour.normalize();
+    _out[cell-_begin] = colour;
+  }
+}
+
+float verify(const GridConfig &_grid, const ngl::Mat4 &_prefix)
+{
+  MatrixArray kernel(_grid.cellCount());
+  computeMatrices(_grid, _prefix, 0, kernel.size(), kernel.data());
+
+  float maxError = 0.0f;
+  ngl::Transformation tx;
+  tx.setScale(_grid.scale, _grid.scale, _grid.scale);
+  for(size_t cell = 0; cell < kernel.size(); ++cell)
+  {
+    tx.setPosition(_grid.cellX(static_cast<uint32_t>(cell % _grid.cellsX)), 0.0f,
+                   _grid.cellZ(static_cast<uint32_t>(cell / _grid.cellsX)));
+    ngl::Mat4 reference = _prefix*tx.getMatrix();
+    for(int i = 0; i < 16; ++i)
+    {
+      maxError = std::max(maxError, std::fabs(reference.m_openGL[i]-kernel[cell].m_openGL[i]));
+    }
+  }
+  return maxError;
+}
+
+const char *name()
+{
+#ifdef GRID_KERNEL_SSE
+  return "sse";
+#else
+  return "scalar";
+#endif
+}
+
+} // end namespace GridKernel
@@ -0,0 +1,48 @@
+#include "GridLod.h"
+#include <algorithm>
+#include <cmath>
+
+constexpr uint32_t GridLod::MaxLevels;
+
+void GridLod::addLevel(const std::string &_name, float _minPixels, uint32_t _vertexCount, float _sx, float _sy, float _sz)
+{
+  if(m_levels.size() < MaxLevels)
+  {
+    m_levels.push_back({_name, _minPixels, _vertexCount, {_sx, _sy, _sz}});
+  }
+}
+
+void GridLod::setCamera(const float *_eye, float _pixelScale)
+{
+  std::copy(_eye, _eye+3, m_eye);
+  m_pixelScale = _pixelScale;
+}
+
+float GridLod::pixels(float _x, float _y, float _z, float _radius) const
+{
+  const float dx = _x-m_eye[0];
+  const float dy = _y-m_eye[1];
+  const float dz = _z-m_eye[2];
+  // distance to the nearest point of the sphere, anything touching the eye is as big as it gets
+  const float distance = std::sqrt(dx*dx+dy*dy+dz*dz)-_radius;
+  if(distance <= 0.0f)
+  {
+    return HUGE_VALF;
+  }
+  return 2.0f*_radius*m_pixelScale/distance;
+}
+
+uint32_t GridLod::select(float _pixels, uint32_t _current) const
+{
+  const uint32_t count = levelCount();
+  uint32_t level = std::min(_current, count-1);
+  while(level+1 < count && _pixels < m_levels[level].minPixels*(1.0f-m_hysteresis))
+  {
+    ++level;
+  }
+  while(level > 0 && _pixels >= m_levels[level-1].minPixels*(1.0f+m_hysteresis))
+  {
+    --level;
+  }
+  return level;
+}
@@ -0,0 +1,140 @@
+#include "GridModel.h"
+#include <algorithm>
+
+constexpr uint32_t GridModel::TileSize;
+constexpr float GridModel::CellExtent;
+
+void GridModel::setConfig(const GridConfig &_config)
+{
+  if(_config != m_config)
+  {
+    m_config = _config;
+    m_dirty = true;
+  }
+}
+
+bool GridModel::update(JobSystem &_jobs)
+{
+  if(!m_dirty)
+  {
+    return false;
+  }
+  rebuild(_jobs);
+  m_dirty = false;
+  return true;
+}
+
+void GridModel::computeTile(const Tile &_tile, const ngl::Mat4 &_prefix, ngl::Mat4 *_out) const
+{
+  for(uint32_t row = 0; row < _tile.h; ++row)
+  {
+    size_t begin = static_cast<size_t>(_tile.iz+row)*m_config.cellsX+_tile.ix;
+    GridKernel::computeMatrices(m_config, _prefix, begin, begin+_tile.w, _out+row*_tile.w);
+  }
+}
+
+void GridModel::rebuild(JobSystem &_jobs)
+{
+  m_tiles.clear();
+  m_nodes.clear();
+  m_tilesX = (m_config.cellsX+TileSize-1)/TileSize;
+  const float radius = cellRadius();
+  uint32_t first = 0;
+  for(uint32_t iz = 0; iz < m_config.cellsZ; iz += TileSize)
+  {
+    for(uint32_t ix = 0; ix < m_config.cellsX; ix += TileSize)
+    {
+      Tile tile;
+      tile.ix = ix;
+      tile.iz = iz;
+      tile.w = std::min(TileSize, m_config.cellsX-ix);
+      tile.h = std::min(TileSize, m_config.cellsZ-iz);
+      tile.first = first;
+      tile.min[0] = m_config.cellX(ix)-radius;
+      tile.min[1] = -radius;
+      tile.min[2] = m_config.cellZ(iz)-radius;
+      tile.max[0] = m_config.cellX(ix+tile.w-1)+radius;
+      tile.max[1] = radius;
+      tile.max[2] = m_config.cellZ(iz+tile.h-1)+radius;
+      first += tile.count();
+      m_tiles.push_back(tile);
+    }
+  }
+  if(!m_tiles.empty())
+  {
+    m_nodes.resize(1);
+    buildNode(0, 0, 0, m_tilesX, static_cast<uint32_t>(m_tiles.size())/m_tilesX);
+  }
+  m_models.resize(m_config.cellCount());
+  m_colours.resize(m_config.cellCount());
+
+  // each tile writes its own slice so no synchronisation is needed
+  _jobs.parallelFor(0, m_tiles.size(), 1, [this](size_t _begin, size_t _end)
+  {
+    const ngl::Mat4 identity;
+    for(size_t t = _begin; t < _end; ++t)
+    {
+      const Tile &tile = m_tiles[t];
+      // identity prefix gives the plain model matrices
+      computeTile(tile, identity, &m_models[tile.first]);
+      for(uint32_t row = 0; row < tile.h; ++row)
+      {
+        size_t begin = static_cast<size_t>(tile.iz+row)*m_config.cellsX+tile.ix;
+        GridKernel::computeColours(m_config, begin, begin+tile.w, &m_colours[tile.first+row*tile.w]);
+      }
+    }
+  });
+}
+
+void GridModel::buildNode(uint32_t _slot, uint32_t _tx0, uint32_t _tz0, uint32_t _tx1, uint32_t _tz1)
+{
+  if(_tx1-_tx0 == 1 && _tz1-_tz0 == 1)
+  {
+    Node &leaf = m_nodes[_slot];
+    const Tile &tile = m_tiles[_tz0*m_tilesX+_tx0];
+    std::copy(tile.min, tile.min+3, leaf.min);
+    std::copy(tile.max, tile.max+3, leaf.max);
+    leaf.firstChild = 0;
+    leaf.childCount = 0;
+    leaf.tile = _tz0*m_tilesX+_tx0;
+    return;
+  }
+  // split each axis that is more than one tile wide, giving two or four children
+  uint32_t xSplit[3] = { _tx0, (_tx0+_tx1+1)/2, _tx1 };
+  uint32_t zSplit[3] = { _tz0, (_tz0+_tz1+1)/2, _tz1 };
+  uint32_t xParts = _tx1-_tx0 > 1 ? 2 : 1;
+  uint32_t zParts = _tz1-_tz0 > 1 ? 2 : 1;
+  if(xParts == 1)
+  {
+    xSplit[1] = _tx1;
+  }
+  if(zParts == 1)
+  {
+    zSplit[1] = _tz1;
+  }
+  const uint32_t firstChild = static_cast<uint32_t>(m_nodes.size());
+  const uint32_t childCount = xParts*zParts;
+  m_nodes.resize(firstChild+childCount);
+  for(uint32_t z = 0; z < zParts; ++z)
+  {
+    for(uint32_t x = 0; x < xParts; ++x)
+    {
+      buildNode(firstChild+z*xParts+x, xSplit[x], zSplit[z], xSplit[x+1], zSplit[z+1]);
+    }
+  }
+  // m_nodes may have grown so only take the reference once the children are done
+  Node &node = m_nodes[_slot];
+  node.firstChild = firstChild;
+  node.childCount = childCount;
+  node.tile = 0;
+  std::copy(m_nodes[firstChild].min, m_nodes[firstChild].min+3, node.min);
+  std::copy(m_nodes[firstChild].max, m_nodes[firstChild].max+3, node.max);
+  for(uint32_t c = 1; c < childCount; ++c)
+  {
+    for(int i = 0; i < 3; ++i)
+    {
+      node.min[i] = std::min(node.min[i], m_nodes[firstChild+c].min[i]);
+      node.max[i] = std::max(node.max[i], m_nodes[firstChild+c].max[i]);
+    }
+  }
+}
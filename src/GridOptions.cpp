@@ -0,0 +1,121 @@
+#include "GridOptions.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <utility>
+
+namespace
+{
+// a spacing or scale of 0 (what toFloat gives for a typo) divides by zero in the streamer and the picker,
+// a far plane of 0 in the projection
+bool positive(const QString &_value, float &o_value)
+{
+  bool ok = false;
+  o_value = _value.toFloat(&ok);
+  return ok && std::isfinite(o_value) && o_value > 0.0f;
+}
+}
+
+GridOptions::GridOptions(QCommandLineParser &_parser) :
+  m_parser(_parser),
+  m_cells("cells", "cells along both x and z", "n"),
+  m_cellsX("cells-x", "cells along x, overrides --cells", "n"),
+  m_cellsZ("cells-z", "cells along z, overrides --cells", "n"),
+  m_step("step", "distance between cells", "units"),
+  m_scale("scale", "uniform scale of each cell", "factor"),
+  m_far("far", "distance to the far clipping plane, how far the grid is drawn (10 by default)", "units"),
+  m_threads("threads", "threads preparing each frame, 0 for one per core", "n", "0"),
+  m_procedural("procedural", "start in the procedural draw mode, nothing is stored per cell"),
+  m_streamed("streamed", "start in the streamed draw mode, an unbounded grid built around the camera"),
+  m_tileBudget("tile-budget", "memory for the streamed tiles", "MB"),
+  m_capture("capture", "record every frame into a directory from launch, R toggles recording", "directory"),
+  m_captureSize("capture-size", "size of the recorded frames, the window size by default", "WxH"),
+  m_captureRaw("capture-raw", "record raw RGBA frames instead of PNG"),
+  m_renderThread("render-thread", "draw and present on a thread of its own, the GUI thread only handles input")
+{
+  m_parser.addOption(m_cells);
+  m_parser.addOption(m_cellsX);
+  m_parser.addOption(m_cellsZ);
+  m_parser.addOption(m_step);
+  m_parser.addOption(m_scale);
+  m_parser.addOption(m_far);
+  m_parser.addOption(m_threads);
+  m_parser.addOption(m_procedural);
+  m_parser.addOption(m_streamed);
+  m_parser.addOption(m_tileBudget);
+  m_parser.addOption(m_capture);
+  m_parser.addOption(m_captureSize);
+  m_parser.addOption(m_captureRaw);
+  m_parser.addOption(m_renderThread);
+}
+
+GridConfig GridOptions::config() const
+{
+  GridConfig grid;
+  if(m_parser.isSet(m_cells))
+  {
+    grid.cellsX = grid.cellsZ = static_cast<uint32_t>(std::max(1, m_parser.value(m_cells).toInt()));
+  }
+  if(m_parser.isSet(m_cellsX))
+  {
+    grid.cellsX = static_cast<uint32_t>(std::max(1, m_parser.value(m_cellsX).toInt()));
+  }
+  if(m_parser.isSet(m_cellsZ))
+  {
+    grid.cellsZ = static_cast<uint32_t>(std::max(1, m_parser.value(m_cellsZ).toInt()));
+  }
+  float value;
+  if(m_parser.isSet(m_step) && positive(m_parser.value(m_step), value))
+  {
+    grid.step = value;
+  }
+  if(m_parser.isSet(m_scale) && positive(m_parser.value(m_scale), value))
+  {
+    grid.scale = value;
+  }
+  return grid;
+}
+
+bool GridOptions::valid() const
+{
+  float value;
+  bool valid = true;
+  const std::pair<const char *, const QCommandLineOption *> options[] = { {"step", &m_step}, {"scale", &m_scale},
+                                                                           {"far", &m_far} };
+  for(const std::pair<const char *, const QCommandLineOption *> &option : options)
+  {
+    if(m_parser.isSet(*option.second) && !positive(m_parser.value(*option.second), value))
+    {
+      std::cerr<<"--"<<option.first<<" must be a positive number, not \""<<m_parser.value(*option.second).toStdString()<<"\"\n";
+      valid = false;
+    }
+  }
+  return valid;
+}
+
+float GridOptions::farPlane() const
+{
+  float value;
+  return m_parser.isSet(m_far) && positive(m_parser.value(m_far), value) ? value : 0.0f;
+}
+
+unsigned int GridOptions::threads() const
+{
+  return static_cast<unsigned int>(std::max(0, m_parser.value(m_threads).toInt()));
+}
+
+size_t GridOptions::tileBudget() const
+{
+  return static_cast<size_t>(std::max(0, m_parser.value(m_tileBudget).toInt())) << 20;
+}
+
+void GridOptions::captureSize(int &o_width, int &o_height) const
+{
+  o_width = o_height = 0;
+  const QStringList size = m_parser.value(m_captureSize).split("x");
+  if(size.size() == 2)
+  {
+    o_width = std::max(0, size[0].toInt());
+    o_height = std::max(0, size[1].toInt());
+  }
+}
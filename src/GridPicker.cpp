@@ -0,0 +1,278 @@
+#include "GridPicker.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+// the most footprint steps one pick takes, only reached by rays skimming the unbounded grid
+constexpr uint32_t MaxSteps = 1 << 14;
+// cell range of the unbounded grid, kept well inside int32_t so the rounding below never overflows
+constexpr int32_t UnboundedCells = 1 << 30;
+
+using Clock = std::chrono::steady_clock;
+
+double microsSince(Clock::time_point _start)
+{
+  return std::chrono::duration<double, std::micro>(Clock::now()-_start).count();
+}
+}
+
+GridPicker::Ray GridPicker::unproject(float _x, float _y, int _width, int _height, const ngl::Mat4 &_inverseClip)
+{
+  // pixel centre to NDC, window y runs down
+  const float ndc[2] = { 2.0f*(_x+0.5f)/_width-1.0f, 1.0f-2.0f*(_y+0.5f)/_height };
+  const float *m = _inverseClip.openGL();
+  auto transform = [&](float _z, float *o_point)
+  {
+    float p[4];
+    for(int row = 0; row < 4; ++row)
+    {
+      p[row] = m[row]*ndc[0]+m[4+row]*ndc[1]+m[8+row]*_z+m[12+row];
+    }
+    for(int i = 0; i < 3; ++i)
+    {
+      o_point[i] = p[i]/p[3];
+    }
+  };
+  float nearPoint[3];
+  float farPoint[3];
+  transform(-1.0f, nearPoint);
+  transform(1.0f, farPoint);
+  Ray ray;
+  float length = 0.0f;
+  for(int i = 0; i < 3; ++i)
+  {
+    ray.origin[i] = nearPoint[i];
+    ray.direction[i] = farPoint[i]-nearPoint[i];
+    length += ray.direction[i]*ray.direction[i];
+  }
+  length = std::sqrt(length);
+  for(float &d : ray.direction)
+  {
+    d /= length;
+  }
+  return ray;
+}
+
+bool GridPicker::clip(const Ray &_ray, const float *_min, const float *_max, float &io_near, float &io_far)
+{
+  for(int i = 0; i < 3; ++i)
+  {
+    if(_ray.direction[i] == 0.0f)
+    {
+      if(_ray.origin[i] < _min[i] || _ray.origin[i] > _max[i])
+      {
+        return false;
+      }
+      continue;
+    }
+    const float inverse = 1.0f/_ray.direction[i];
+    float t0 = (_min[i]-_ray.origin[i])*inverse;
+    float t1 = (_max[i]-_ray.origin[i])*inverse;
+    if(t0 > t1)
+    {
+      std::swap(t0, t1);
+    }
+    io_near = std::max(io_near, t0);
+    io_far = std::min(io_far, t1);
+  }
+  return io_near <= io_far;
+}
+
+bool GridPicker::slab(const Ray &_ray, float _radius, float &o_near, float &o_far)
+{
+  const float min[3] = { -HUGE_VALF, -_radius, -HUGE_VALF };
+  const float max[3] = { HUGE_VALF, _radius, HUGE_VALF };
+  o_near = 0.0f;
+  o_far = HUGE_VALF;
+  return clip(_ray, min, max, o_near, o_far);
+}
+
+void GridPicker::walk(const Layout &_layout, const Ray &_ray, float _near, float _far, Hit &io_hit)
+{
+  const float *o = _ray.origin;
+  const float *d = _ray.direction;
+  const float r = _layout.radius;
+  // a step moves the ray about one cell along x or z, so the cells within r of it stay a narrow box.
+  // A sphere entered at t is within r of the ray at t, so it is found by the step covering t and the
+  // walk can stop at the first step starting past the nearest hit.
+  const float across = std::max(std::abs(d[0]), std::abs(d[2]));
+  const float length = across > 0.0f ? _layout.step/across : _far-_near;
+  auto cellRange = [&](float _a, float _b, float _origin, int32_t _min, int32_t _max, int32_t &o_first, int32_t &o_last)
+  {
+    const float first = std::ceil((std::min(_a, _b)-r-_origin)/_layout.step);
+    const float last = std::floor((std::max(_a, _b)+r-_origin)/_layout.step);
+    o_first = static_cast<int32_t>(std::max(first, static_cast<float>(_min)));
+    o_last = static_cast<int32_t>(std::min(last, static_cast<float>(_max)));
+  };
+  float t0 = _near;
+  for(uint32_t step = 0; step < MaxSteps && t0 <= _far; ++step)
+  {
+    if(io_hit.valid && t0 >= io_hit.distance)
+    {
+      return;
+    }
+    const float t1 = std::min(t0+length, _far);
+    int32_t ix0, ix1, iz0, iz1;
+    cellRange(o[0]+d[0]*t0, o[0]+d[0]*t1, _layout.originX, _layout.minX, _layout.maxX, ix0, ix1);
+    cellRange(o[2]+d[2]*t0, o[2]+d[2]*t1, _layout.originZ, _layout.minZ, _layout.maxZ, iz0, iz1);
+    for(int32_t iz = iz0; iz <= iz1; ++iz)
+    {
+      for(int32_t ix = ix0; ix <= ix1; ++ix)
+      {
+        const float ox = o[0]-(_layout.originX+ix*_layout.step);
+        const float oz = o[2]-(_layout.originZ+iz*_layout.step);
+        const float b = ox*d[0]+o[1]*d[1]+oz*d[2];
+        const float c = ox*ox+o[1]*o[1]+oz*oz-r*r;
+        const float discriminant = b*b-c;
+        ++io_hit.tested;
+        if(discriminant < 0.0f)
+        {
+          continue;
+        }
+        // an origin inside the sphere hits it straight away, one in front of it never does
+        float t = -b-std::sqrt(discriminant);
+        if(c <= 0.0f)
+        {
+          t = 0.0f;
+        }
+        else if(t < 0.0f)
+        {
+          continue;
+        }
+        if(!io_hit.valid || t < io_hit.distance)
+        {
+          io_hit.valid = true;
+          io_hit.ix = ix;
+          io_hit.iz = iz;
+          io_hit.distance = t;
+          io_hit.centre[0] = _layout.originX+ix*_layout.step;
+          io_hit.centre[1] = 0.0f;
+          io_hit.centre[2] = _layout.originZ+iz*_layout.step;
+        }
+      }
+    }
+    if(t1 >= _far)
+    {
+      return;
+    }
+    t0 = t1;
+  }
+}
+
+void GridPicker::walkNode(const GridModel &_model, const Layout &_layout, const Ray &_ray, uint32_t _node,
+                          float _near, float _far, Hit &io_hit)
+{
+  const GridModel::Node &node = _model.nodes()[_node];
+  if(!clip(_ray, node.min, node.max, _near, _far) || (io_hit.valid && _near >= io_hit.distance))
+  {
+    return;
+  }
+  if(node.childCount == 0)
+  {
+    const GridModel::Tile &tile = _model.tiles()[node.tile];
+    Layout local = _layout;
+    local.minX = static_cast<int32_t>(tile.ix);
+    local.minZ = static_cast<int32_t>(tile.iz);
+    local.maxX = static_cast<int32_t>(tile.ix+tile.w)-1;
+    local.maxZ = static_cast<int32_t>(tile.iz+tile.h)-1;
+    walk(local, _ray, _near, _far, io_hit);
+    return;
+  }
+  // nearest child first so the ones behind a hit are skipped
+  std::pair<float, uint32_t> order[4];
+  uint32_t count = 0;
+  for(uint32_t c = 0; c < node.childCount; ++c)
+  {
+    const GridModel::Node &child = _model.nodes()[node.firstChild+c];
+    float childNear = _near;
+    float childFar = _far;
+    if(clip(_ray, child.min, child.max, childNear, childFar))
+    {
+      order[count++] = { childNear, node.firstChild+c };
+    }
+  }
+  std::sort(order, order+count);
+  for(uint32_t c = 0; c < count; ++c)
+  {
+    walkNode(_model, _layout, _ray, order[c].second, _near, _far, io_hit);
+  }
+}
+
+void GridPicker::finish(const Ray &_ray, Hit &io_hit)
+{
+  for(int i = 0; i < 3; ++i)
+  {
+    io_hit.point[i] = _ray.origin[i]+_ray.direction[i]*io_hit.distance;
+  }
+}
+
+GridPicker::Hit GridPicker::pick(const GridModel &_model, const Ray &_ray)
+{
+  const Clock::time_point start = Clock::now();
+  Hit hit;
+  const GridConfig &grid = _model.config();
+  float enter;
+  float leave;
+  if(!_model.nodes().empty() && slab(_ray, _model.cellRadius(), enter, leave))
+  {
+    const Layout layout = { grid.originX(), grid.originZ(), grid.step, _model.cellRadius(), 0, 0, 0, 0 };
+    walkNode(_model, layout, _ray, 0, enter, leave, hit);
+  }
+  if(hit.valid)
+  {
+    hit.cell = static_cast<uint32_t>(hit.iz)*grid.cellsX+static_cast<uint32_t>(hit.ix);
+    finish(_ray, hit);
+  }
+  hit.micros = microsSince(start);
+  return hit;
+}
+
+GridPicker::Hit GridPicker::pick(const GridConfig &_grid, const Ray &_ray)
+{
+  const Clock::time_point start = Clock::now();
+  Hit hit;
+  const float radius = GridModel::CellExtent*_grid.scale;
+  float enter;
+  float leave;
+  if(_grid.cellCount() != 0 && slab(_ray, radius, enter, leave))
+  {
+    // the whole grid as one box, the walk stays inside it
+    const float min[3] = { _grid.originX()-radius, -radius, _grid.originZ()-radius };
+    const float max[3] = { _grid.cellX(_grid.cellsX-1)+radius, radius, _grid.cellZ(_grid.cellsZ-1)+radius };
+    if(clip(_ray, min, max, enter, leave))
+    {
+      const Layout layout = { _grid.originX(), _grid.originZ(), _grid.step, radius, 0, 0,
+                              static_cast<int32_t>(_grid.cellsX)-1, static_cast<int32_t>(_grid.cellsZ)-1 };
+      walk(layout, _ray, enter, leave, hit);
+    }
+  }
+  if(hit.valid)
+  {
+    hit.cell = static_cast<uint32_t>(hit.iz)*_grid.cellsX+static_cast<uint32_t>(hit.ix);
+    finish(_ray, hit);
+  }
+  hit.micros = microsSince(start);
+  return hit;
+}
+
+GridPicker::Hit GridPicker::pickUnbounded(float _step, float _scale, const Ray &_ray)
+{
+  const Clock::time_point start = Clock::now();
+  Hit hit;
+  const float radius = GridModel::CellExtent*_scale;
+  float enter;
+  float leave;
+  if(slab(_ray, radius, enter, leave))
+  {
+    const Layout layout = { 0.0f, 0.0f, _step, radius, -UnboundedCells, -UnboundedCells, UnboundedCells, UnboundedCells };
+    walk(layout, _ray, enter, leave, hit);
+  }
+  if(hit.valid)
+  {
+    finish(_ray, hit);
+  }
+  hit.micros = microsSince(start);
+  return hit;
+}
@@ -0,0 +1,1114 @@
+#include "GridRenderer.h"
+#include "Frustum.h"
+#include "ProgramCache.h"
+#include <ngl/NGLInit.h>
+#include <ngl/AbstractVAO.h>
+#include <ngl/VAOPrimitives.h> // methods to create primitives - torus, sphere, and built in prims
+#include <ngl/Util.h>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// attribute locations used by ColourVertex.glsl, the model matrix takes 4 consecutive slots
+constexpr GLuint InstanceColourLocation = 3;
+constexpr GLuint InstanceModelLocation = 4;
+constexpr GLuint QueueCellLocation = 8;
+// vertex buffer binding points for the instanced attributes, clear of the ones NGL uses for the mesh
+constexpr GLuint QueueCellBinding = 13;
+constexpr GLuint InstanceModelBinding = 14;
+constexpr GLuint InstanceColourBinding = 15;
+// uniform block binding of the Camera block in ColourVertex.glsl
+constexpr GLuint CameraBinding = 0;
+// uniform block binding of the Grid block and the shader storage binding of the overrides in
+// ColourVertex.glsl, clear of the ones CullCompute.glsl uses
+constexpr GLuint GridBinding = 1;
+constexpr GLuint OverrideBinding = 5;
+// shader storage bindings the queued colour programs fetch the models and colours from
+constexpr GLuint QueueModelBinding = 6;
+constexpr GLuint QueueColourBinding = 7;
+// starting size of each frame's region of the stream buffer, it grows if a frame needs more
+constexpr size_t StreamRegionBytes = 256*1024;
+// work group size of CullCompute.glsl and the square work group of DepthPyramid.glsl
+constexpr GLuint CullGroupSize = 64;
+constexpr GLuint PyramidGroupSize = 8;
+// texture and image unit of the depth pyramid in both compute shaders
+constexpr GLuint PyramidUnit = 0;
+// the colour block is aligned to the largest SSBO offset alignment seen in practice
+constexpr size_t ColourAlignment = 256;
+// near clipping plane of the projection, the far one is set through setFarPlane
+constexpr float NearPlane = 0.5f;
+// the highlight is drawn this much larger than its cell so it encloses it
+constexpr float HighlightScale = 1.15f;
+// tints of the Mixed mode's materials, multiplied with each cell's colour
+constexpr uint32_t QueueMaterials = 6;
+constexpr float QueueTints[QueueMaterials][4] = { {1.0f, 1.0f, 1.0f, 1.0f}, {1.0f, 0.6f, 0.6f, 1.0f},
+                                                  {0.6f, 1.0f, 0.6f, 1.0f}, {0.6f, 0.6f, 1.0f, 1.0f},
+                                                  {1.0f, 1.0f, 0.5f, 1.0f}, {0.5f, 0.5f, 0.5f, 1.0f} };
+
+constexpr uint32_t GridRenderer::QueueShaders;
+
+GridRenderer::~GridRenderer()
+{
+  glDeleteBuffers(1, &m_instanceBuffer);
+  glDeleteBuffers(1, &m_culledBuffer);
+  glDeleteBuffers(1, &m_cullCommandBuffer);
+  glDeleteBuffers(1, &m_cullReadback);
+  for(GLsync fence : m_cullFences)
+  {
+    glDeleteSync(fence);
+  }
+  glDeleteBuffers(1, &m_overrideBuffer);
+  glDeleteBuffers(1, &m_tileBuffer);
+  glDeleteTextures(1, &m_depthTexture);
+  glDeleteTextures(1, &m_pyramid);
+  glDeleteFramebuffers(1, &m_depthFbo);
+  glDeleteProgram(m_colourProgram.id());
+  glDeleteProgram(m_cullProgram.id());
+  glDeleteProgram(m_pyramidProgram.id());
+  for(const ShaderProgram &program : m_queuePrograms)
+  {
+    glDeleteProgram(program.id());
+  }
+}
+
+void GridRenderer::initialize()
+{
+  // we need to initialise the NGL lib which will load all of the OpenGL functions, this must
+  // be done once we have a valid GL context but before we call any GL commands. If we dont do
+  // this everything will crash
+  ngl::NGLInit::instance();
+  glClearColor(1.0f, 1.0f, 1.0f, 1.0f);			   // Grey Background
+  // enable depth testing for drawing
+  glEnable(GL_DEPTH_TEST);
+  // enable multisampling for smoother drawing
+  glEnable(GL_MULTISAMPLE);
+
+  // start the programs first so the driver builds them while the buffers below are set up,
+  // GRID_SHADER_CACHE moves the stored binaries and an empty value turns the cache off
+  const char *cachePath = std::getenv("GRID_SHADER_CACHE");
+  ProgramCache programs(cachePath != nullptr ? cachePath : ".shadercache");
+  auto colour = programs.request("colour", {{GL_VERTEX_SHADER, "shaders/ColourVertex.glsl"},
+                                            {GL_FRAGMENT_SHADER, "shaders/ColourFragment.glsl"}});
+  auto cull = programs.request("cull", {{GL_COMPUTE_SHADER, "shaders/CullCompute.glsl"}});
+  auto pyramid = programs.request("pyramid", {{GL_COMPUTE_SHADER, "shaders/DepthPyramid.glsl"}});
+  ProgramCache::Handle queued[QueueShaders];
+  queued[0] = programs.request("queued", {{GL_VERTEX_SHADER, "shaders/ColourVertex.glsl"},
+                                          {GL_FRAGMENT_SHADER, "shaders/ColourFragment.glsl"}}, {"QUEUED"});
+  queued[1] = programs.request("queuedLit", {{GL_VERTEX_SHADER, "shaders/ColourVertex.glsl"},
+                                             {GL_FRAGMENT_SHADER, "shaders/ColourFragment.glsl"}}, {"QUEUED", "LIT"});
+
+  createLods();
+  m_camera = UniformBlock<CameraBlock>(CameraBinding);
+  m_gridBlock = UniformBlock<GridBlock>(GridBinding);
+  glGenBuffers(1, &m_overrideBuffer);
+
+  m_view = ngl::lookAt({0.0f, 2.0f, 2.0f},  //gen a func sim to glu lookat, 4*4 matrix
+                       ngl::Vec3::zero(),   // return a 0 matrix
+                       ngl::Vec3::up());    // return a 0 mat
+
+  setupInstanceAttributes();
+  createQueueMeshes();
+  m_stream.create(StreamRegionBytes);
+
+  glGenBuffers(1, &m_cullCommandBuffer);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_cullCommandBuffer);
+  glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(CullCommand), nullptr, GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+  // two slots so the stats read last frame's count while this frame writes the other
+  const GLbitfield readFlags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  glGenBuffers(1, &m_cullReadback);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, m_cullReadback);
+  glBufferStorage(GL_COPY_WRITE_BUFFER, 2*sizeof(CullCommand), nullptr, readFlags);
+  m_cullReadbackData = static_cast<const CullCommand *>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, 2*sizeof(CullCommand), readFlags));
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+  // from here on the programs are driven directly with their locations resolved once
+  m_colourProgram = ShaderProgram(programs.take(colour));
+  m_lodScale.resolve(m_colourProgram, "lodScale");
+  m_procedural.resolve(m_colourProgram, "procedural");
+  m_cullProgram = ShaderProgram(programs.take(cull));
+  if(m_cullProgram.valid())
+  {
+    m_cullPlanes.resolve(m_cullProgram, "planes");
+    m_cullRadius.resolve(m_cullProgram, "cellRadius");
+    m_cullCount.resolve(m_cullProgram, "cellCount");
+    m_cullPyramidVP.resolve(m_cullProgram, "pyramidViewProject");
+    m_cullPyramidInfo.resolve(m_cullProgram, "pyramidInfo");
+  }
+  m_pyramidProgram = ShaderProgram(programs.take(pyramid));
+  if(m_pyramidProgram.valid())
+  {
+    m_pyramidSourceLevel.resolve(m_pyramidProgram, "sourceLevel");
+  }
+  for(uint32_t shader = 0; shader < QueueShaders; ++shader)
+  {
+    m_queuePrograms[shader] = ShaderProgram(programs.take(queued[shader]));
+    m_queueTint[shader].resolve(m_queuePrograms[shader], "materialTint");
+  }
+  programs.report(std::cout);
+  m_programStats = programs.stats();
+
+  if(const char *tracePath = std::getenv("GRID_TRACE"))
+  {
+    m_trace.start(tracePath);
+  }
+  if(const char *profilePath = std::getenv("GRID_PROFILE"))
+  {
+    m_profiler.startLog(profilePath);
+  }
+}
+
+void GridRenderer::resize(int _w, int _h)
+{
+  m_width = _w;
+  m_height = _h;
+  m_project = ngl::perspective(45.0f, static_cast<float>(_w)/_h,
+                               NearPlane, m_farPlane); //FOV , last are near and far clipping planes
+}
+
+void GridRenderer::setFarPlane(float _far)
+{
+  m_farPlane = _far;
+  resize(m_width, m_height);
+}
+
+void GridRenderer::createLods()
+{
+  // NGL only has the one teapot so the coarser levels are low tessellation spheres stretched to roughly
+  // its bounds. The thresholds are of the cell's bounding sphere, about 1.6 times the teapot, so the
+  // spheres only take over once the teapot itself is around 4 and 2 pixels across and the spout and
+  // handle are already lost in the rasterisation. Cells that small are past the default far plane, so
+  // the coarser levels only show once setFarPlane reaches beyond about 135 units
+  ngl::VAOPrimitives *prim = ngl::VAOPrimitives::instance();
+  prim->createSphere("teapotLod1", 1.0f, 12);
+  prim->createSphere("teapotLod2", 1.0f, 6);
+  auto vertices = [prim](const char *_name)
+  {
+    return static_cast<uint32_t>(prim->getVAOFromName(_name)->numIndices());
+  };
+  m_lod.addLevel("teapot", 6.0f, vertices("teapot"));
+  m_lod.addLevel("teapotLod1", 3.0f, vertices("teapotLod1"), 1.5f, 0.8f, 1.0f);
+  m_lod.addLevel("teapotLod2", 0.0f, vertices("teapotLod2"), 1.5f, 0.8f, 1.0f);
+}
+
+void GridRenderer::createQueueMeshes()
+{
+  // the teapot and some of NGL's generated shapes, roughly the size of the teapot
+  ngl::VAOPrimitives *prim = ngl::VAOPrimitives::instance();
+  prim->createSphere("sphere", 0.8f, 16);
+  prim->createTorus("torus", 0.2f, 0.6f, 12, 24);
+  prim->createCone("cone", 0.6f, 1.2f, 16, 4);
+  m_queueMeshes.clear();
+  for(const char *name : {"teapot", "sphere", "torus", "cone"})
+  {
+    ngl::AbstractVAO *vao = prim->getVAOFromName(name);
+    vao->bind();
+    // left disabled so the other modes can draw the teapot, drawQueue enables it while it binds a mesh
+    glVertexAttribIFormat(QueueCellLocation, 1, GL_UNSIGNED_INT, 0);
+    glVertexAttribBinding(QueueCellLocation, QueueCellBinding);
+    glVertexBindingDivisor(QueueCellBinding, 1);
+    vao->unbind();
+    m_queueMeshes.push_back(vao);
+  }
+}
+
+void GridRenderer::updateLodCamera(const ngl::Mat4 &_mouseRotation)
+{
+  // the eye is the origin of eye space, so grid space is the translation of the inverse
+  ngl::Mat4 gridToEye = m_view*_mouseRotation;
+  ngl::Mat4 eyeToGrid = gridToEye.inverse();
+  m_lod.setCamera(&eyeToGrid.m_openGL[12], 0.5f*m_height*m_project.m_openGL[5]);
+}
+
+void GridRenderer::setupInstanceAttributes()
+{
+  // the attributes become part of each VAO's state so binding it is enough to draw, either the whole
+  // grid instanced or one cell at a time with baseInstance
+  for(const GridLod::Level &level : m_lod.levels())
+  {
+    ngl::AbstractVAO *vao = ngl::VAOPrimitives::instance()->getVAOFromName(level.name);
+    vao->bind();
+    glEnableVertexAttribArray(InstanceColourLocation);
+    glVertexAttribFormat(InstanceColourLocation, 4, GL_FLOAT, GL_FALSE, 0);
+    glVertexAttribBinding(InstanceColourLocation, InstanceColourBinding);
+    for(GLuint column = 0; column < 4; ++column)
+    {
+      glEnableVertexAttribArray(InstanceModelLocation+column);
+      glVertexAttribFormat(InstanceModelLocation+column, 4, GL_FLOAT, GL_FALSE, column*4*sizeof(float));
+      glVertexAttribBinding(InstanceModelLocation+column, InstanceModelBinding);
+    }
+    glVertexBindingDivisor(InstanceModelBinding, 1);
+    glVertexBindingDivisor(InstanceColourBinding, 1);
+    vao->unbind();
+  }
+}
+
+void GridRenderer::bindInstanceBuffer(GLuint _buffer, size_t _colourOffset)
+{
+  glBindVertexBuffer(InstanceModelBinding, _buffer, 0, sizeof(ngl::Mat4));
+  glBindVertexBuffer(InstanceColourBinding, _buffer, static_cast<GLintptr>(_colourOffset), sizeof(ngl::Vec4));
+}
+
+void GridRenderer::uploadInstanceBuffer()
+{
+  const GridKernel::MatrixArray &models = m_model.models();
+  const GridKernel::ColourArray &colours = m_model.colours();
+  m_instanceCount = static_cast<GLsizei>(m_model.size());
+  const size_t modelBytes = models.size()*sizeof(ngl::Mat4);
+  const size_t colourBytes = colours.size()*sizeof(ngl::Vec4);
+  m_colourOffset = (modelBytes+ColourAlignment-1)/ColourAlignment*ColourAlignment;
+  const GLsizeiptr totalBytes = static_cast<GLsizeiptr>(m_colourOffset+colourBytes);
+
+  // a new buffer for every rebuild so frames still in flight keep reading the old one, it stays
+  // mapped for its whole life so the workers can write straight into it
+  glDeleteBuffers(1, &m_instanceBuffer);
+  glDeleteBuffers(1, &m_culledBuffer);
+  m_instanceBuffer = 0;
+  m_culledBuffer = 0;
+  m_instanceData = nullptr;
+  // the cells may have moved since the pyramid was drawn
+  m_pyramidValid = false;
+  if(m_instanceCount == 0)
+  {
+    return;
+  }
+  const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  glGenBuffers(1, &m_instanceBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+  glBufferStorage(GL_ARRAY_BUFFER, totalBytes, nullptr, flags);
+  m_instanceData = static_cast<char *>(glMapBufferRange(GL_ARRAY_BUFFER, 0, totalBytes, flags));
+  // same layout, written by the compute cull
+  glGenBuffers(1, &m_culledBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, m_culledBuffer);
+  glBufferStorage(GL_ARRAY_BUFFER, totalBytes, nullptr, 0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  // every tile owns a contiguous slice of both arrays so they copy in parallel without locking
+  const std::vector<GridModel::Tile> &tiles = m_model.tiles();
+  char *data = m_instanceData;
+  const size_t colourOffset = m_colourOffset;
+  m_jobs.parallelFor(0, tiles.size(), 1, [&](size_t _begin, size_t _end)
+  {
+    for(size_t t = _begin; t < _end; ++t)
+    {
+      const GridModel::Tile &tile = tiles[t];
+      std::memcpy(data+tile.first*sizeof(ngl::Mat4), &models[tile.first], tile.count()*sizeof(ngl::Mat4));
+      std::memcpy(data+colourOffset+tile.first*sizeof(ngl::Vec4), &colours[tile.first], tile.count()*sizeof(ngl::Vec4));
+    }
+  });
+
+  // every level reads the full buffer, only the finest is switched to m_culledBuffer by the compute cull
+  attachInstanceBuffer(m_instanceBuffer, m_colourOffset);
+}
+
+void GridRenderer::attachInstanceBuffer(GLuint _buffer, size_t _colourOffset)
+{
+  for(const GridLod::Level &level : m_lod.levels())
+  {
+    ngl::AbstractVAO *vao = ngl::VAOPrimitives::instance()->getVAOFromName(level.name);
+    vao->bind();
+    bindInstanceBuffer(_buffer, _colourOffset);
+    vao->unbind();
+  }
+}
+
+void GridRenderer::render(const ngl::Mat4 &_mouseRotation)
+{
+  ++m_frame;
+  // everything the last frame took from the arena is done with, its draws were issued before it returned
+  m_arena.reset();
+  m_profiler.beginFrame(m_frame);
+  // QPainter (the profiler overlay) turns depth testing off when it finishes
+  glEnable(GL_DEPTH_TEST);
+  // clear the screen and depth buffer
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  glViewport(0,0,m_width,m_height);
+  m_profiler.mark(FrameProfiler::Clear);
+  m_stats = FrameStats();
+  // only blocks if the GPU is StreamBuffer::Regions frames behind
+  const StreamBuffer::Counters streamBefore = m_stream.counters();
+  m_stream.beginFrame();
+  m_stats.fenceWaits = static_cast<uint32_t>(m_stream.counters().fenceWaits-streamBefore.fenceWaits);
+  m_stats.fenceWaitMs = m_stream.counters().fenceWaitMs-streamBefore.fenceWaitMs;
+  auto prepareStart = std::chrono::steady_clock::now();
+  // the procedural and streamed modes never touch the stored cells so they are only built once another mode needs them
+  const bool rebuilt = m_drawMode != DrawMode::Procedural && m_drawMode != DrawMode::Streamed && m_model.update(m_jobs);
+  // the only per frame transform work, every cell shares the camera and mouse rotation
+  ngl::Mat4 VP = m_project*m_view*_mouseRotation;
+  m_occlusionStale = occlusionActive() && m_pyramidValid &&
+                     std::memcmp(VP.m_openGL, m_pyramidVP.m_openGL, sizeof(VP.m_openGL)) != 0;
+  if(cpuCommands())
+  {
+    updateLodCamera(_mouseRotation);
+    m_culler.cull(m_model, VP, m_lod, m_jobs, m_arena, m_cullMode != CullMode::None);
+    m_stats.culled = m_culler.stats().culled;
+    m_stats.tilesCulled = m_culler.stats().tilesCulled;
+    if(m_drawMode == DrawMode::Mixed)
+    {
+      queueCells(VP);
+    }
+  }
+  else if(m_drawMode == DrawMode::Streamed)
+  {
+    streamTiles(_mouseRotation, VP);
+  }
+  m_stats.prepareMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-prepareStart).count();
+  m_profiler.mark(FrameProfiler::Prepare);
+
+  if(rebuilt)
+  {
+    uploadInstanceBuffer();
+  }
+  if(m_drawMode == DrawMode::Streamed)
+  {
+    uploadTiles();
+  }
+  // NGL or Qt may have changed the program and uniform bindings since the last frame
+  ShaderProgram::resetCurrent();
+  m_camera.update(m_stream, {m_view, m_project, _mouseRotation, VP});
+  updateGridBlock();
+  m_profiler.mark(FrameProfiler::Upload);
+
+  switch(m_drawMode)
+  {
+    case DrawMode::PerDraw : drawPerCell(); break;
+    case DrawMode::Instanced : drawInstanced(VP); break;
+    case DrawMode::Procedural : drawProcedural(); break;
+    case DrawMode::Streamed : drawStreamed(); break;
+    case DrawMode::Mixed : drawQueue(); break;
+  }
+  // the pyramid only holds the grid, the enlarged highlight would hide the cells around the pick
+  if(occlusionActive())
+  {
+    buildDepthPyramid(VP);
+  }
+  else
+  {
+    m_pyramidValid = false;
+  }
+  drawHighlight();
+  m_profiler.mark(FrameProfiler::Draw);
+  m_stream.endFrame();
+  if(m_trace.enabled() && m_drawMode != DrawMode::Procedural && m_drawMode != DrawMode::Streamed)
+  {
+    traceFrame(VP);
+  }
+
+  if(cpuCommands() && m_drawMode != DrawMode::Mixed)
+  {
+    std::copy(m_culler.stats().levels, m_culler.stats().levels+GridLod::MaxLevels, m_stats.levels);
+  }
+  else if(m_drawMode != DrawMode::Streamed && m_drawMode != DrawMode::Mixed)
+  {
+    m_stats.levels[0] = m_stats.instances;
+  }
+  for(uint32_t level = 0; level < m_lod.levelCount(); ++level)
+  {
+    m_stats.vertices += static_cast<uint64_t>(m_stats.levels[level])*m_lod.level(level).vertexCount;
+  }
+  // every level is drawn as GL_TRIANGLES
+  m_profiler.endFrame(m_stats.drawCalls, m_stats.vertices/3);
+}
+
+void GridRenderer::useProgram(const ShaderProgram &_program)
+{
+  if(_program.use())
+  {
+    ++m_stats.programBinds;
+  }
+}
+
+ngl::AbstractVAO *GridRenderer::bindLevel(uint32_t _level)
+{
+  const GridLod::Level &level = m_lod.level(_level);
+  useProgram(m_colourProgram);
+  m_procedural.set(0);
+  m_lodScale.set(ngl::Vec3(level.scale[0], level.scale[1], level.scale[2]));
+  ngl::AbstractVAO *vao = ngl::VAOPrimitives::instance()->getVAOFromName(level.name);
+  vao->bind();
+  return vao;
+}
+
+void GridRenderer::drawPerCell()
+{
+  // still one draw call per cell, but the model matrix and colour come from the instance attributes
+  // through baseInstance so nothing is uploaded per cell
+  if(cpuCommands())
+  {
+    for(uint32_t level = 0; level < m_lod.levelCount(); ++level)
+    {
+      const std::vector<GridCuller::Command> &commands = m_culler.commands(level);
+      if(commands.empty())
+      {
+        continue;
+      }
+      ngl::AbstractVAO *vao = bindLevel(level);
+      for(const GridCuller::Command &command : commands)
+      {
+        for(uint32_t i = 0; i < command.instanceCount; ++i)
+        {
+          glDrawArraysInstancedBaseInstance(vao->getMode(), 0, static_cast<GLsizei>(command.count), 1, command.baseInstance+i);
+          ++m_stats.drawCalls;
+        }
+      }
+      vao->unbind();
+    }
+  }
+  else if(m_instanceCount > 0)
+  {
+    ngl::AbstractVAO *vao = bindLevel(0);
+    for(GLuint i = 0; i < static_cast<GLuint>(m_instanceCount); ++i)
+    {
+      glDrawArraysInstancedBaseInstance(vao->getMode(), 0, static_cast<GLsizei>(vao->numIndices()), 1, i);
+      ++m_stats.drawCalls;
+    }
+    vao->unbind();
+  }
+  m_stats.instances = m_stats.drawCalls;
+}
+
+void GridRenderer::drawInstanced(const ngl::Mat4 &_VP)
+{
+  if(m_instanceCount == 0)
+  {
+    return;
+  }
+  if(gpuCull())
+  {
+    cullOnGpu(_VP);
+  }
+  if(cpuCommands())
+  {
+    drawCommands(m_culler.levels());
+    m_stats.instances = m_culler.stats().visible;
+    return;
+  }
+  ngl::AbstractVAO *vao = bindLevel(0);
+  if(gpuCull())
+  {
+    bindInstanceBuffer(m_culledBuffer, m_colourOffset);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_cullCommandBuffer);
+    glDrawArraysIndirect(vao->getMode(), nullptr);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    // keep a copy of the counts for the stats, read back next frame so it never waits on the GPU
+    glBindBuffer(GL_COPY_READ_BUFFER, m_cullCommandBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_cullReadback);
+    const size_t slot = m_frame & 1;
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, slot*sizeof(CullCommand), sizeof(CullCommand));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glDeleteSync(m_cullFences[slot]);
+    m_cullFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    // last frame's copy is only read once its fence has passed, until then the older counts stand in
+    GLsync &previous = m_cullFences[slot ^ 1];
+    if(previous != nullptr && glClientWaitSync(previous, 0, 0) != GL_TIMEOUT_EXPIRED)
+    {
+      m_cullCounts = m_cullReadbackData[slot ^ 1];
+      glDeleteSync(previous);
+      previous = nullptr;
+    }
+    m_stats.instances = m_cullCounts.draw.instanceCount;
+    m_stats.occluded = m_cullCounts.occluded;
+    m_stats.culled = static_cast<uint32_t>(m_instanceCount)-std::min(m_stats.instances, static_cast<uint32_t>(m_instanceCount));
+    // keep the other paths reading the full buffer
+    bindInstanceBuffer(m_instanceBuffer, m_colourOffset);
+  }
+  else
+  {
+    glDrawArraysInstanced(vao->getMode(), 0, static_cast<GLsizei>(vao->numIndices()), m_instanceCount);
+    m_stats.instances = static_cast<uint32_t>(m_instanceCount);
+  }
+  vao->unbind();
+  m_stats.drawCalls = 1;
+}
+
+void GridRenderer::setCellOverride(uint32_t _cell, const ngl::Mat4 &_model, const ngl::Vec4 &_colour)
+{
+  CellOverride &entry = m_overrides[_cell];
+  entry.model = _model;
+  entry.colour = _colour;
+  entry.cell = _cell;
+  m_overridesDirty = true;
+}
+
+void GridRenderer::clearCellOverride(uint32_t _cell)
+{
+  m_overridesDirty |= m_overrides.erase(_cell) != 0;
+}
+
+void GridRenderer::clearCellOverrides()
+{
+  m_overrides.clear();
+  m_overridesDirty = true;
+}
+
+void GridRenderer::uploadOverrides()
+{
+  if(!m_overridesDirty)
+  {
+    return;
+  }
+  m_overridesDirty = false;
+  // always at least one entry so the block has storage behind it, the shader reads none when empty
+  const size_t count = std::max<size_t>(1, m_overrides.size());
+  CellOverride *sorted = m_arena.allocate<CellOverride>(count);
+  sorted[0] = CellOverride();
+  size_t i = 0;
+  for(const std::pair<const uint32_t, CellOverride> &entry : m_overrides)
+  {
+    sorted[i++] = entry.second;
+  }
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_overrideBuffer);
+  glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(count*sizeof(CellOverride)), sorted, GL_STATIC_DRAW);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void GridRenderer::updateGridBlock()
+{
+  // bound in every mode as the colour program declares both, only the procedural mode reads them
+  uploadOverrides();
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OverrideBinding, m_overrideBuffer);
+  const GridConfig &grid = m_model.config();
+  GridBlock block;
+  block.origin[0] = grid.originX();
+  block.origin[1] = grid.originZ();
+  block.origin[2] = grid.step;
+  block.origin[3] = grid.scale;
+  block.cells[0] = grid.cellsX;
+  block.cells[1] = grid.cellsZ;
+  block.cells[2] = static_cast<uint32_t>(m_overrides.size());
+  block.cells[3] = 0;
+  m_gridBlock.update(m_stream, block);
+}
+
+void GridRenderer::drawProcedural()
+{
+  const GLsizei cells = static_cast<GLsizei>(m_model.config().cellCount());
+  if(cells == 0)
+  {
+    return;
+  }
+  ngl::AbstractVAO *vao = bindLevel(0);
+  m_procedural.set(1);
+  // nothing is read from the instance buffer, which may not even exist yet
+  glDisableVertexAttribArray(InstanceColourLocation);
+  for(GLuint column = 0; column < 4; ++column)
+  {
+    glDisableVertexAttribArray(InstanceModelLocation+column);
+  }
+  glDrawArraysInstanced(vao->getMode(), 0, static_cast<GLsizei>(vao->numIndices()), cells);
+  glEnableVertexAttribArray(InstanceColourLocation);
+  for(GLuint column = 0; column < 4; ++column)
+  {
+    glEnableVertexAttribArray(InstanceModelLocation+column);
+  }
+  vao->unbind();
+  m_stats.drawCalls = 1;
+  m_stats.instances = static_cast<uint32_t>(cells);
+}
+
+void GridRenderer::assignCellStates()
+{
+  // a hash of the instance spreads the shaders, meshes and materials evenly and keeps them from
+  // following the grid order, which would leave nothing for the sort to do
+  m_cellStates.resize(m_model.size());
+  uint32_t *states = m_cellStates.data();
+  const uint32_t meshes = static_cast<uint32_t>(m_queueMeshes.size());
+  m_jobs.parallelFor(0, m_cellStates.size(), 4096, [states, meshes](size_t _begin, size_t _end)
+  {
+    for(size_t i = _begin; i < _end; ++i)
+    {
+      uint32_t hash = static_cast<uint32_t>(i)*0x9e3779b1u;
+      hash ^= hash >> 15;
+      hash *= 0x2c1b3c6du;
+      hash ^= hash >> 12;
+      states[i] = RenderQueue::state(hash % QueueShaders, (hash >> 8) % meshes, (hash >> 16) % QueueMaterials);
+    }
+  });
+}
+
+void GridRenderer::queueCells(const ngl::Mat4 &_VP)
+{
+  if(m_cellStates.size() != m_model.size())
+  {
+    assignCellStates();
+  }
+  // every level's commands, the level of detail chain is the teapot's so the queue ignores it
+  size_t commandCount = 0;
+  for(uint32_t level = 0; level < m_lod.levelCount(); ++level)
+  {
+    commandCount += m_culler.commands(level).size();
+  }
+  const GridCuller::Command **commands = m_arena.allocate<const GridCuller::Command *>(commandCount);
+  uint32_t *offsets = m_arena.allocate<uint32_t>(commandCount);
+  size_t next = 0;
+  uint32_t total = 0;
+  for(uint32_t level = 0; level < m_lod.levelCount(); ++level)
+  {
+    for(const GridCuller::Command &command : m_culler.commands(level))
+    {
+      commands[next] = &command;
+      offsets[next++] = total;
+      total += command.instanceCount;
+    }
+  }
+  m_queue.reset(total, m_arena);
+
+  // clip space w is the distance in front of the eye, so each cell only needs the bottom row of VP
+  const float w[4] = { _VP.m_openGL[3], _VP.m_openGL[7], _VP.m_openGL[11], _VP.m_openGL[15] };
+  const GridKernel::MatrixArray &models = m_model.models();
+  const uint32_t *states = m_cellStates.data();
+  RenderQueue::Packet *packets = m_queue.packets();
+  m_jobs.parallelFor(0, commandCount, 64, [&](size_t _begin, size_t _end)
+  {
+    for(size_t c = _begin; c < _end; ++c)
+    {
+      const GridCuller::Command &command = *commands[c];
+      RenderQueue::Packet *out = packets+offsets[c];
+      for(uint32_t i = 0; i < command.instanceCount; ++i)
+      {
+        const uint32_t instance = command.baseInstance+i;
+        const ngl::Mat4 &model = models[instance];
+        const float depth = w[0]*model.m_m[3][0]+w[1]*model.m_m[3][1]+w[2]*model.m_m[3][2]+w[3];
+        out[i].key = RenderQueue::key(states[instance], depth);
+        out[i].instance = instance;
+      }
+    }
+  });
+
+  auto sortStart = std::chrono::steady_clock::now();
+  m_queue.sort();
+  m_stats.sortMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-sortStart).count();
+  m_stats.unsortedChanges = m_queue.unsortedChanges();
+  m_stats.sortedChanges = m_queue.sortedChanges();
+}
+
+void GridRenderer::drawQueue()
+{
+  if(m_queue.batchCount() == 0 || m_instanceBuffer == 0)
+  {
+    return;
+  }
+  for(const ShaderProgram &program : m_queuePrograms)
+  {
+    if(!program.valid())
+    {
+      return;
+    }
+  }
+  // the sorted instance list is all that is written per frame, the shaders fetch the rest by index
+  StreamBuffer::Allocation order = m_stream.allocate(m_queue.size()*sizeof(GLuint));
+  GLuint *out = static_cast<GLuint *>(order.data);
+  const RenderQueue::Packet *packets = m_queue.packets();
+  for(size_t i = 0; i < m_queue.size(); ++i)
+  {
+    out[i] = packets[i].instance;
+  }
+  const size_t modelBytes = static_cast<size_t>(m_instanceCount)*sizeof(ngl::Mat4);
+  const size_t colourBytes = static_cast<size_t>(m_instanceCount)*sizeof(ngl::Vec4);
+  glBindBufferRange(GL_SHADER_STORAGE_BUFFER, QueueModelBinding, m_instanceBuffer, 0, static_cast<GLsizeiptr>(modelBytes));
+  glBindBufferRange(GL_SHADER_STORAGE_BUFFER, QueueColourBinding, m_instanceBuffer, static_cast<GLintptr>(m_colourOffset), static_cast<GLsizeiptr>(colourBytes));
+
+  // the batches come sorted so each bind below only happens where its part of the key changes
+  const uint32_t none = ~0u;
+  uint32_t shader = none;
+  uint32_t material = none;
+  ngl::AbstractVAO *vao = nullptr;
+  const RenderQueue::Batch *batches = m_queue.batches();
+  for(size_t b = 0; b < m_queue.batchCount(); ++b)
+  {
+    const RenderQueue::Batch &batch = batches[b];
+    if(batch.shader != shader)
+    {
+      shader = batch.shader;
+      useProgram(m_queuePrograms[shader]);
+      // the tint is a uniform of each program
+      material = none;
+    }
+    ngl::AbstractVAO *mesh = m_queueMeshes[batch.mesh];
+    if(mesh != vao)
+    {
+      if(vao != nullptr)
+      {
+        glDisableVertexAttribArray(QueueCellLocation);
+        vao->unbind();
+      }
+      vao = mesh;
+      vao->bind();
+      glEnableVertexAttribArray(QueueCellLocation);
+      glBindVertexBuffer(QueueCellBinding, order.buffer, order.offset, sizeof(GLuint));
+    }
+    if(batch.material != material)
+    {
+      material = batch.material;
+      m_queueTint[shader].set(ngl::Vec4(QueueTints[material][0], QueueTints[material][1],
+                                        QueueTints[material][2], QueueTints[material][3]));
+    }
+    // baseInstance offsets the sorted instance list, so each batch reads its own run of it
+    const GLsizei vertices = static_cast<GLsizei>(vao->numIndices());
+    glDrawArraysInstancedBaseInstance(vao->getMode(), 0, vertices, static_cast<GLsizei>(batch.count), batch.first);
+    ++m_stats.drawCalls;
+    m_stats.vertices += static_cast<uint64_t>(batch.count)*static_cast<uint64_t>(vertices);
+  }
+  glDisableVertexAttribArray(QueueCellLocation);
+  vao->unbind();
+  m_stats.instances = static_cast<uint32_t>(m_queue.size());
+}
+
+void GridRenderer::drawCommands(const std::vector<GridCuller::Command> *_levels)
+{
+  // every level goes into one stream allocation, the GPU reads it while the CPU moves on to other regions
+  const uint32_t levelCount = m_lod.levelCount();
+  size_t total = 0;
+  for(uint32_t level = 0; level < levelCount; ++level)
+  {
+    total += _levels[level].size();
+  }
+  if(total == 0)
+  {
+    return;
+  }
+  StreamBuffer::Allocation indirect = m_stream.allocate(total*sizeof(GridCuller::Command));
+  GridCuller::Command *out = static_cast<GridCuller::Command *>(indirect.data);
+  for(uint32_t level = 0; level < levelCount; ++level)
+  {
+    const std::vector<GridCuller::Command> &commands = _levels[level];
+    out = std::copy(commands.begin(), commands.end(), out);
+  }
+
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect.buffer);
+  size_t offset = static_cast<size_t>(indirect.offset);
+  for(uint32_t level = 0; level < levelCount; ++level)
+  {
+    const std::vector<GridCuller::Command> &commands = _levels[level];
+    if(!commands.empty())
+    {
+      ngl::AbstractVAO *vao = bindLevel(level);
+      glMultiDrawArraysIndirect(vao->getMode(), reinterpret_cast<const void *>(offset), static_cast<GLsizei>(commands.size()), 0);
+      vao->unbind();
+      ++m_stats.drawCalls;
+    }
+    offset += commands.size()*sizeof(GridCuller::Command);
+  }
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void GridRenderer::streamTiles(const ngl::Mat4 &_mouseRotation, const ngl::Mat4 &_VP)
+{
+  for(std::vector<GridCuller::Command> &commands : m_tileCommands)
+  {
+    commands.clear();
+  }
+  const GridConfig &grid = m_model.config();
+  m_streamer.setLayout(grid.step, grid.scale);
+  updateLodCamera(_mouseRotation);
+  // nothing past the far plane is drawn so that is as far as the tiles need to reach
+  ngl::Mat4 eyeToGrid = (m_view*_mouseRotation).inverse();
+  m_streamer.update(eyeToGrid.m_openGL[12], eyeToGrid.m_openGL[14], m_farPlane, m_frame, m_arena);
+
+  // a whole tile is culled and takes one level of detail, picked from a cell at its centre
+  Frustum frustum(_VP);
+  const float radius = m_streamer.cellRadius();
+  for(TileStreamer::Tile *tile : m_streamer.tiles())
+  {
+    if(frustum.test(tile->min, tile->max) == Frustum::Result::Outside)
+    {
+      ++m_stats.tilesCulled;
+      m_stats.culled += TileStreamer::TileCells;
+      continue;
+    }
+    const float x = 0.5f*(tile->min[0]+tile->max[0]);
+    const float z = 0.5f*(tile->min[2]+tile->max[2]);
+    tile->level = m_lod.select(m_lod.pixels(x, 0.0f, z, radius), tile->level);
+    m_tileCommands[tile->level].push_back({ m_lod.level(tile->level).vertexCount, TileStreamer::TileCells, 0,
+                                            tile->slot*TileStreamer::TileCells });
+    m_stats.levels[tile->level] += TileStreamer::TileCells;
+    m_stats.instances += TileStreamer::TileCells;
+  }
+}
+
+void GridRenderer::uploadTiles()
+{
+  if(m_tileCapacity != m_streamer.capacity())
+  {
+    // the streamer empties every slot when the budget changes, frames in flight keep reading the old buffer
+    glDeleteBuffers(1, &m_tileBuffer);
+    m_tileBuffer = 0;
+    m_tileData = nullptr;
+    m_tileCapacity = m_streamer.capacity();
+    const size_t cells = static_cast<size_t>(m_tileCapacity)*TileStreamer::TileCells;
+    m_tileColourOffset = (cells*sizeof(ngl::Mat4)+ColourAlignment-1)/ColourAlignment*ColourAlignment;
+    const GLsizeiptr totalBytes = static_cast<GLsizeiptr>(m_tileColourOffset+cells*sizeof(ngl::Vec4));
+    if(m_tileCapacity > 0)
+    {
+      const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+      glGenBuffers(1, &m_tileBuffer);
+      glBindBuffer(GL_ARRAY_BUFFER, m_tileBuffer);
+      glBufferStorage(GL_ARRAY_BUFFER, totalBytes, nullptr, flags);
+      m_tileData = static_cast<char *>(glMapBufferRange(GL_ARRAY_BUFFER, 0, totalBytes, flags));
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+  }
+  if(m_tileData == nullptr)
+  {
+    return;
+  }
+  // a slot is only handed out once the frames that drew its previous tile are done with it
+  for(const TileStreamer::Upload &upload : m_streamer.uploads())
+  {
+    const size_t first = static_cast<size_t>(upload.slot)*TileStreamer::TileCells;
+    std::memcpy(m_tileData+first*sizeof(ngl::Mat4), upload.models, TileStreamer::TileCells*sizeof(ngl::Mat4));
+    std::memcpy(m_tileData+m_tileColourOffset+first*sizeof(ngl::Vec4), upload.colours, TileStreamer::TileCells*sizeof(ngl::Vec4));
+  }
+}
+
+void GridRenderer::drawStreamed()
+{
+  if(m_tileBuffer == 0)
+  {
+    return;
+  }
+  attachInstanceBuffer(m_tileBuffer, m_tileColourOffset);
+  drawCommands(m_tileCommands);
+  // the other modes expect the VAOs to read the grid
+  attachInstanceBuffer(m_instanceBuffer, m_colourOffset);
+}
+
+GridPicker::Hit GridRenderer::pick(float _x, float _y, const ngl::Mat4 &_mouseRotation) const
+{
+  ngl::Mat4 clip = m_project*m_view*_mouseRotation;
+  const GridPicker::Ray ray = GridPicker::unproject(_x, _y, m_width, m_height, clip.inverse());
+  const GridConfig &grid = m_model.config();
+  if(m_drawMode == DrawMode::Streamed)
+  {
+    return GridPicker::pickUnbounded(grid.step, grid.scale, ray);
+  }
+  // the procedural mode never builds the quadtree, the layout alone is enough
+  return m_model.built() ? GridPicker::pick(m_model, ray) : GridPicker::pick(grid, ray);
+}
+
+void GridRenderer::setHighlight(const GridPicker::Hit &_hit)
+{
+  m_highlight = _hit.valid;
+  std::copy(_hit.centre, _hit.centre+3, m_highlightCentre);
+}
+
+void GridRenderer::drawHighlight()
+{
+  if(!m_highlight)
+  {
+    return;
+  }
+  // a single instance from the stream buffer, laid out like the instance buffers
+  ngl::Mat4 model;
+  model.m_m[0][0] = model.m_m[1][1] = model.m_m[2][2] = HighlightScale*m_model.config().scale;
+  model.m_m[3][0] = m_highlightCentre[0];
+  model.m_m[3][1] = m_highlightCentre[1];
+  model.m_m[3][2] = m_highlightCentre[2];
+  const ngl::Vec4 colour(1.0f, 0.5f, 0.0f, 1.0f);
+  StreamBuffer::Allocation instance = m_stream.allocate(sizeof(ngl::Mat4)+sizeof(ngl::Vec4));
+  std::memcpy(instance.data, &model, sizeof(ngl::Mat4));
+  std::memcpy(static_cast<char *>(instance.data)+sizeof(ngl::Mat4), &colour, sizeof(ngl::Vec4));
+
+  ngl::AbstractVAO *vao = bindLevel(0);
+  glBindVertexBuffer(InstanceModelBinding, instance.buffer, instance.offset, sizeof(ngl::Mat4));
+  glBindVertexBuffer(InstanceColourBinding, instance.buffer, instance.offset+static_cast<GLintptr>(sizeof(ngl::Mat4)), sizeof(ngl::Vec4));
+  glDrawArraysInstanced(vao->getMode(), 0, static_cast<GLsizei>(vao->numIndices()), 1);
+  bindInstanceBuffer(m_instanceBuffer, m_colourOffset);
+  vao->unbind();
+  ++m_stats.drawCalls;
+}
+
+void GridRenderer::traceFrame(const ngl::Mat4 &_VP)
+{
+  // the GPU builds the per cell MVP so rebuild it here, only paid for while tracing
+  const GridKernel::MatrixArray &models = m_model.models();
+  const GridKernel::ColourArray &colours = m_model.colours();
+  const std::vector<GridModel::Tile> &tiles = m_model.tiles();
+  // the commands only give instance ranges so walk the tiles alongside to recover the grid index
+  size_t tile = 0;
+  auto record = [&](uint32_t _instance)
+  {
+    while(_instance >= tiles[tile].first+tiles[tile].count())
+    {
+      ++tile;
+    }
+    m_trace.record(m_frame, m_model.cellIndex(tiles[tile], _instance-tiles[tile].first), _VP*models[_instance], colours[_instance]);
+  };
+  if(cpuCommands())
+  {
+    for(uint32_t level = 0; level < m_lod.levelCount(); ++level)
+    {
+      tile = 0;
+      for(const GridCuller::Command &command : m_culler.commands(level))
+      {
+        for(uint32_t i = 0; i < command.instanceCount; ++i)
+        {
+          record(command.baseInstance+i);
+        }
+      }
+    }
+  }
+  else
+  {
+    for(uint32_t i = 0; i < static_cast<uint32_t>(m_instanceCount); ++i)
+    {
+      record(i);
+    }
+  }
+}
+
+void GridRenderer::cullOnGpu(const ngl::Mat4 &_VP)
+{
+  const CullCommand reset = { { m_lod.level(0).vertexCount, 0, 0, 0 }, 0 };
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_cullCommandBuffer);
+  glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(reset), &reset);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+  const size_t modelBytes = static_cast<size_t>(m_instanceCount)*sizeof(ngl::Mat4);
+  const size_t colourBytes = static_cast<size_t>(m_instanceCount)*sizeof(ngl::Vec4);
+  glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, m_instanceBuffer, 0, static_cast<GLsizeiptr>(modelBytes));
+  glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 1, m_instanceBuffer, static_cast<GLintptr>(m_colourOffset), static_cast<GLsizeiptr>(colourBytes));
+  glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 2, m_culledBuffer, 0, static_cast<GLsizeiptr>(modelBytes));
+  glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 3, m_culledBuffer, static_cast<GLintptr>(m_colourOffset), static_cast<GLsizeiptr>(colourBytes));
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_cullCommandBuffer);
+
+  Frustum frustum(_VP);
+  useProgram(m_cullProgram);
+  // the planes are packed as 6 vec4s
+  m_cullPlanes.set(reinterpret_cast<const ngl::Vec4 *>(frustum.planes()), 6);
+  m_cullRadius.set(m_model.cellRadius());
+  m_cullCount.set(static_cast<GLuint>(m_instanceCount));
+  // no levels turns the occlusion test off
+  if(occlusionActive() && m_pyramidValid)
+  {
+    m_cullPyramidVP.set(m_pyramidVP);
+    m_cullPyramidInfo.set(ngl::Vec4(static_cast<float>(m_depthWidth), static_cast<float>(m_depthHeight),
+                                    static_cast<float>(m_pyramidLevels), 0.0f));
+    glActiveTexture(GL_TEXTURE0+PyramidUnit);
+    glBindTexture(GL_TEXTURE_2D, m_pyramid);
+  }
+  else
+  {
+    m_cullPyramidInfo.set(ngl::Vec4(0.0f, 0.0f, 0.0f, 0.0f));
+  }
+  glDispatchCompute((static_cast<GLuint>(m_instanceCount)+CullGroupSize-1)/CullGroupSize, 1, 1);
+  // the indirect draw, the instance attributes and the copy of the counts for the stats all read what it wrote
+  glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void GridRenderer::buildDepthPyramid(const ngl::Mat4 &_VP)
+{
+  m_pyramidValid = false;
+  GLint framebuffer = 0;
+  glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(framebuffer));
+  // a depth blit needs matching formats, so copy into one made to match whatever is bound
+  const GLenum depthAttachment = framebuffer == 0 ? GL_DEPTH : GL_DEPTH_ATTACHMENT;
+  const GLenum stencilAttachment = framebuffer == 0 ? GL_STENCIL : GL_STENCIL_ATTACHMENT;
+  GLint depthObject = GL_NONE;
+  glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, depthAttachment, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &depthObject);
+  if(depthObject == GL_NONE)
+  {
+    return;
+  }
+  GLint depthBits = 0;
+  GLint depthType = GL_NONE;
+  GLint depthName = 0;
+  glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, depthAttachment, GL_FRAMEBUFFER_ATTACHMENT_DEPTH_SIZE, &depthBits);
+  glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, depthAttachment, GL_FRAMEBUFFER_ATTACHMENT_COMPONENT_TYPE, &depthType);
+  glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, depthAttachment, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME, &depthName);
+  // packed depth stencil shows up as the same image attached to both
+  bool packed = false;
+  GLint stencilObject = GL_NONE;
+  glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, stencilAttachment, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &stencilObject);
+  if(stencilObject != GL_NONE)
+  {
+    GLint stencilName = 0;
+    glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, stencilAttachment, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME, &stencilName);
+    packed = framebuffer == 0 || stencilName == depthName;
+  }
+  GLenum format = packed ? GL_DEPTH24_STENCIL8 : GL_DEPTH_COMPONENT24;
+  if(depthType == GL_FLOAT)
+  {
+    format = packed ? GL_DEPTH32F_STENCIL8 : GL_DEPTH_COMPONENT32F;
+  }
+  else if(!packed && depthBits == 16)
+  {
+    format = GL_DEPTH_COMPONENT16;
+  }
+  else if(!packed && depthBits == 32)
+  {
+    format = GL_DEPTH_COMPONENT32;
+  }
+
+  // the top level is a power of two so every texel of a level covers a whole number of texels of the one above
+  GLint size[2] = { 1, 1 };
+  while(size[0]*2 < m_width)
+  {
+    size[0] *= 2;
+  }
+  while(size[1]*2 < m_height)
+  {
+    size[1] *= 2;
+  }
+  if(format != m_depthFormat || m_width != m_depthWidth || m_height != m_depthHeight)
+  {
+    glDeleteTextures(1, &m_depthTexture);
+    glDeleteTextures(1, &m_pyramid);
+    m_depthFormat = format;
+    m_depthWidth = m_width;
+    m_depthHeight = m_height;
+    glGenTextures(1, &m_depthTexture);
+    glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, format, m_width, m_height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    if(m_depthFbo == 0)
+    {
+      glGenFramebuffers(1, &m_depthFbo);
+    }
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_depthFbo);
+    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0);
+    glDrawBuffer(GL_NONE);
+
+    m_pyramidLevels = 1;
+    for(GLint largest = std::max(size[0], size[1]); largest > 1; largest /= 2)
+    {
+      ++m_pyramidLevels;
+    }
+    glGenTextures(1, &m_pyramid);
+    glBindTexture(GL_TEXTURE_2D, m_pyramid);
+    glTexStorage2D(GL_TEXTURE_2D, m_pyramidLevels, GL_R32F, size[0], size[1]);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+  }
+  // also resolves a multisampled depth buffer
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_depthFbo);
+  glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, m_width, m_height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+  glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(framebuffer));
+
+  // each level reads the one above, the barrier makes its writes visible to the fetches
+  useProgram(m_pyramidProgram);
+  glActiveTexture(GL_TEXTURE0+PyramidUnit);
+  for(GLint level = 0; level < m_pyramidLevels; ++level)
+  {
+    glBindTexture(GL_TEXTURE_2D, level == 0 ? m_depthTexture : m_pyramid);
+    m_pyramidSourceLevel.set(level == 0 ? 0 : level-1);
+    glBindImageTexture(PyramidUnit, m_pyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    const GLuint width = static_cast<GLuint>(std::max(1, size[0] >> level));
+    const GLuint height = static_cast<GLuint>(std::max(1, size[1] >> level));
+    glDispatchCompute((width+PyramidGroupSize-1)/PyramidGroupSize, (height+PyramidGroupSize-1)/PyramidGroupSize, 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+  m_pyramidVP = _VP;
+  m_pyramidValid = true;
+}
@@ -0,0 +1,187 @@
+#include "JobSystem.h"
+#include <algorithm>
+
+constexpr size_t JobSystem::TaskQueue::Capacity;
+
+bool JobSystem::TaskQueue::push(const Task &_task)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if(tail-head == Capacity)
+  {
+    return false;
+  }
+  tasks[tail++ % Capacity] = _task;
+  return true;
+}
+
+bool JobSystem::TaskQueue::pop(Task &o_task)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if(tail == head)
+  {
+    return false;
+  }
+  o_task = tasks[--tail % Capacity];
+  return true;
+}
+
+bool JobSystem::TaskQueue::steal(Task &o_task)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if(tail == head)
+  {
+    return false;
+  }
+  o_task = tasks[head++ % Capacity];
+  return true;
+}
+
+JobSystem::JobSystem(unsigned int _threads) : m_threadCount(resolve(_threads))
+{
+}
+
+JobSystem::~JobSystem()
+{
+  stop();
+}
+
+void JobSystem::setThreadCount(unsigned int _threads)
+{
+  const unsigned int threads = resolve(_threads);
+  if(threads == m_threadCount)
+  {
+    return;
+  }
+  // the new set starts with the next parallelFor
+  stop();
+  m_queues.clear();
+  m_threadCount = threads;
+}
+
+unsigned int JobSystem::resolve(unsigned int _threads)
+{
+  return _threads != 0 ? _threads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+void JobSystem::start(unsigned int _threads)
+{
+  m_stop = false;
+  m_queues.clear();
+  for(unsigned int i = 0; i < _threads; ++i)
+  {
+    m_queues.emplace_back(new TaskQueue);
+  }
+  // queue 0 belongs to the thread calling parallelFor
+  for(size_t i = 1; i < _threads; ++i)
+  {
+    m_workers.emplace_back(&JobSystem::worker, this, i);
+  }
+}
+
+void JobSystem::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_wakeMutex);
+    m_stop = true;
+  }
+  m_wake.notify_all();
+  for(std::thread &t : m_workers)
+  {
+    t.join();
+  }
+  m_workers.clear();
+}
+
+bool JobSystem::next(size_t _index, Task &o_task)
+{
+  if(m_queues[_index]->pop(o_task))
+  {
+    return true;
+  }
+  for(size_t i = 1; i < m_queues.size(); ++i)
+  {
+    if(m_queues[(_index+i) % m_queues.size()]->steal(o_task))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+void JobSystem::execute(const Task &_task)
+{
+  _task.function(_task.body, _task.begin, _task.end);
+  m_remaining.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void JobSystem::worker(size_t _index)
+{
+  uint64_t seen = 0;
+  for(;;)
+  {
+    Task task;
+    if(next(_index, task))
+    {
+      execute(task);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(m_wakeMutex);
+    m_wake.wait(lock, [this, seen] { return m_stop || m_generation != seen; });
+    if(m_stop)
+    {
+      return;
+    }
+    seen = m_generation;
+  }
+}
+
+void JobSystem::run(size_t _begin, size_t _end, size_t _grain, TaskFunction _function, void *_body)
+{
+  if(_begin >= _end)
+  {
+    return;
+  }
+  _grain = std::max<size_t>(1, _grain);
+  if(m_queues.empty())
+  {
+    start(m_threadCount);
+  }
+  if(m_queues.size() == 1 || _end-_begin <= _grain)
+  {
+    _function(_body, _begin, _end);
+    return;
+  }
+
+  // deal the chunks round robin so every thread starts with local work, anything that does not
+  // fit in a ring runs straight away on the caller
+  size_t chunks = (_end-_begin+_grain-1)/_grain;
+  m_remaining.store(chunks, std::memory_order_release);
+  size_t queue = 0;
+  for(size_t b = _begin; b < _end; b += _grain)
+  {
+    Task task = { _function, _body, b, std::min(_end, b+_grain) };
+    if(!m_queues[queue]->push(task))
+    {
+      execute(task);
+    }
+    queue = (queue+1) % m_queues.size();
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_wakeMutex);
+    ++m_generation;
+  }
+  m_wake.notify_all();
+
+  Task task;
+  while(m_remaining.load(std::memory_order_acquire) != 0)
+  {
+    if(next(0, task))
+    {
+      execute(task);
+    }
+    else
+    {
+      std::this_thread::yield();
+    }
+  }
+}
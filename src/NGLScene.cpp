@@ -1,107 +1,459 @@
 #include <QMouseEvent>
 #include <QGuiApplication>
+#include <QOpenGLPaintDevice>
+#include <QPainter>
 
 #include "NGLScene.h"
-#include <ngl/NGLInit.h>
-#include <ngl/VAOPrimitives.h> // methods to create primitives - torus, sphere, and built in prims
-#include <ngl/ShaderLib.h> // another singleton class, ways of managing itself
-#include <ngl/NGLStream.h> // implements all ostream operators, for printing
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 
-NGLScene::NGLScene()
+// PartialUpdateBlit keeps the last frame in an FBO so paintGL can skip drawing when nothing has changed
+NGLScene::NGLScene(const GridConfig &_grid, unsigned int _threads) : QOpenGLWindow(QOpenGLWindow::PartialUpdateBlit)
 {
   // re-size the widget to that of the parent (in this case the GLFrame passed in on construction)
   setTitle("Blank NGL");
+  // only stores the config, the cells are built on the first frame once we have a context
+  m_renderer.setGrid(_grid);
+  m_renderer.setThreadCount(_threads);
+  // drawing on the GUI thread holds it up from paintGL until the swap returns
+  connect(this, &QOpenGLWindow::frameSwapped, this, [this]()
+  {
+    recordStall(m_paintStart);
+    if(m_presenting)
+    {
+      m_latency.add(std::chrono::duration<double, std::milli>(Clock::now()-m_presentInput).count());
+      m_presenting = false;
+    }
+  });
 }
 
 
 NGLScene::~NGLScene()
 {
   std::cout<<"Shutting down NGL, removing VAO's and Shaders\n";
+  RenderScheduler::Counters frames = m_scheduler.counters();
+  if(m_threaded)
+  {
+    // hands the render thread's context back to this thread, current, for the members released below
+    m_renderThread.stop();
+    const RenderThread::Counters thread = m_renderThread.counters();
+    frames.requested = m_published;
+    frames.coalesced = thread.coalesced;
+    frames.rendered = thread.rendered;
+    frames.skipped = thread.skipped;
+  }
+  else
+  {
+    // the renderer releases its GL objects as it is destroyed so it needs the context
+    makeCurrent();
+  }
+  std::cout<<"Frames requested "<<frames.requested<<" coalesced "<<frames.coalesced
+           <<" rendered "<<frames.rendered<<" skipped "<<frames.skipped<<"\n";
+  const FrameLatency::Summary latency = m_latency.summary();
+  const FrameLatency::Summary stall = m_stall.summary();
+  std::cout<<"Input to present median "<<latency.median<<" ms p99 "<<latency.p99<<" ms max "<<latency.max
+           <<" ms, GUI thread stall per frame median "<<stall.median<<" ms p99 "<<stall.p99<<" ms max "<<stall.max
+           <<" ms"<<(m_threaded ? " with the render thread\n" : "\n");
 }
 
 
 
 void NGLScene::resizeGL(int _w , int _h)
 {
-  m_win.width  = static_cast<int>( _w * devicePixelRatio() );
-  m_win.height = static_cast<int>( _h * devicePixelRatio() );
-  m_project = ngl::perspective(45.0f, static_cast<float>(_w)/_h,
-                               0.5f, 10.0f); //FOV , last are near and far clipping planes
+  m_state.pixelRatio = static_cast<float>(devicePixelRatio());
+  m_state.win.width  = static_cast<int>( _w * devicePixelRatio() );
+  m_state.win.height = static_cast<int>( _h * devicePixelRatio() );
+  requestRender(RenderScheduler::Projection);
+}
+
+void NGLScene::initializeGL()
+{
+  m_renderer.initialize();
+  syncState();
+  m_applied = m_state;
+}
 
+void NGLScene::syncState()
+{
+  m_state.drawMode = m_renderer.drawMode();
+  m_state.cullMode = m_renderer.cullMode();
+  m_state.lod = m_renderer.lod();
+  m_state.occlusion = m_renderer.occlusion();
 }
 
-constexpr char *ColourShader = "Colour Shader"; //compile time replaced
+void NGLScene::setRenderThread(bool _enabled)
+{
+  if(_enabled && !RenderThread::supported())
+  {
+    std::cout<<"OpenGL can not be used from a second thread here, drawing on the GUI thread\n";
+    return;
+  }
+  m_threaded = _enabled;
+}
 
-void NGLScene::initializeGL()
+bool NGLScene::event(QEvent *_event)
 {
-  // we need to initialise the NGL lib which will load all of the OpenGL functions, this must
-  // be done once we have a valid GL context but before we call any GL commands. If we dont do
-  // this everything will crash
-  ngl::NGLInit::instance();
-  glClearColor(1.0f, 1.0f, 1.0f, 1.0f);			   // Grey Background
-  // enable depth testing for drawing
-  glEnable(GL_DEPTH_TEST);
-  // enable multisampling for smoother drawing
-  glEnable(GL_MULTISAMPLE);
+  if(!m_threaded)
+  {
+    return QOpenGLWindow::event(_event);
+  }
+  // QOpenGLWindow would create its own context on the first resize and paint on this thread
+  switch(_event->type())
+  {
+    case QEvent::Resize :
+      resizeGL(width(), height());
+    return true;
+    case QEvent::Expose :
+      m_state.exposed = isExposed();
+      if(m_state.exposed && !m_renderThread.running())
+      {
+        startRenderThread();
+      }
+      // nothing is kept between frames, an exposed window is always drawn again
+      requestRender(RenderScheduler::Projection);
+    return true;
+    case QEvent::UpdateRequest :
+    case QEvent::Paint :
+    return true;
+    default :
+    return QOpenGLWindow::event(_event);
+  }
+}
 
-  ngl::VAOPrimitives::instance()->createSphere("sphere", 1.0f, 40); // initialise sphere with descriptions
-  ngl::ShaderLib *shader = ngl::ShaderLib::instance();
-  shader->loadShader(ColourShader, "shaders/ColourVertex.glsl",
-                      "shaders/ColourFragment.glsl");
+void NGLScene::startRenderThread()
+{
+  syncState();
+  m_applied = m_state;
+  RenderThread::Callbacks callbacks;
+  callbacks.initialize = [this]()
+  {
+    m_renderer.initialize();
+  };
+  callbacks.frame = [this](const SceneState &_state, uint32_t _dirty, GLuint _framebuffer, bool &o_drawn)
+  {
+    return drawFrame(_state, _dirty, _framebuffer, o_drawn);
+  };
+  callbacks.presented = [this](const SceneState &_state, bool _fresh)
+  {
+    if(_fresh)
+    {
+      m_latency.add(std::chrono::duration<double, std::milli>(Clock::now()-_state.input).count());
+    }
+  };
+  m_renderThread.start(this, requestedFormat(), callbacks);
+}
 
-  m_view = ngl::lookAt({0.0f, 2.0f, 2.0f},  //gen a func sim to glu lookat, 4*4 matrix
-                       ngl::Vec3::zero(),   // return a 0 matrix
-                       ngl::Vec3::up());    // return a 0 mat
 
+void NGLScene::setCaptureSize(int _width, int _height, bool _raw)
+{
+  m_captureWidth = _width;
+  m_captureHeight = _height;
+  m_captureRaw = _raw;
 }
 
-void NGLScene::loadMatrixToShader(const ngl::Mat4 &_tx, const ngl::Vec4 &_colour) // getMatrix is a const cant be mutable or something like that
+bool NGLScene::beginCapture(const std::string &_directory)
 {
-    ngl::ShaderLib *shader = ngl::ShaderLib::instance();
-    shader->use(ColourShader); //activate shader
-    //shader->setUniform("MVP", ngl::Mat4(0.2)); // careful of what Mat4
+  return m_capture.start(_directory, m_captureRaw ? FrameCapture::Format::Raw : FrameCapture::Format::Png,
+                         m_captureWidth, m_captureHeight);
+}
 
-    shader->setUniform("MVP", m_project*m_view*_tx); // using proj and view identity matrices from NGLScene
+void NGLScene::startCapture(const std::string &_directory)
+{
+  if(beginCapture(_directory))
+  {
+    requestRender(RenderScheduler::Capture);
+  }
+}
 
-    std::cout<<m_view<<"\n"<<m_project<<"\n"<<_tx<<"\n"
-            <<m_project*m_view*_tx<<"\n";
-    std::cout << "******************" << "\n";
+void NGLScene::requestRender(uint32_t _dirty)
+{
+  if(_dirty == RenderScheduler::None)
+  {
+    return;
+  }
+  if(m_threaded)
+  {
+    publish(_dirty);
+    return;
+  }
+  if(!m_inputPending)
+  {
+    m_inputPending = true;
+    m_inputStart = Clock::now();
+  }
+  if(m_scheduler.invalidate(_dirty))
+  {
+    update();
+  }
+}
 
-    shader->setUniform("vertColour", _colour);
+void NGLScene::publish(uint32_t _dirty)
+{
+  // the render thread starts on the first expose, until then the settings are still being made
+  if(!m_renderThread.running())
+  {
+    return;
+  }
+  const Clock::time_point start = Clock::now();
+  // once every snapshot so far has been taken this input starts a new frame, otherwise the changes and the
+  // input time of the ones still waiting carry over as this replaces them
+  if(m_renderThread.consumed() == m_published)
+  {
+    m_untaken = RenderScheduler::None;
+    m_inputStart = start;
+  }
+  m_untaken |= _dirty;
+  SceneState &snapshot = m_renderThread.snapshot();
+  snapshot = m_state;
+  snapshot.sequence = ++m_published;
+  snapshot.dirty = m_untaken;
+  snapshot.input = m_inputStart;
+  m_renderThread.publish();
+  recordStall(start);
 }
 
+void NGLScene::recordStall(Clock::time_point _start)
+{
+  m_stall.add(std::chrono::duration<double, std::milli>(Clock::now()-_start).count());
+  m_state.stallMs = m_stall.latest();
+  m_state.stallMaxMs = m_stall.max();
+}
 
 void NGLScene::paintGL()
 {
-  // clear the screen and depth buffer
-  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-  glViewport(0,0,m_win.width,m_win.height);
+  m_paintStart = Clock::now();
+  bool drawn = false;
+  // expose events and the like repaint without anything changing, the FBO still holds the last frame
+  const uint32_t again = drawFrame(m_state, m_scheduler.beginFrame(), defaultFramebufferObject(), drawn);
+  if(drawn && m_inputPending)
+  {
+    m_presentInput = m_inputStart;
+    m_presenting = true;
+    m_inputPending = false;
+  }
+  // frames asked for by the frame itself are not input, they do not start a latency sample
+  if(m_scheduler.invalidate(again))
+  {
+    update();
+  }
+}
+
+void NGLScene::applyState(const SceneState &_state)
+{
+  m_renderer.setDrawMode(_state.drawMode);
+  m_renderer.setCullMode(_state.cullMode);
+  m_renderer.setLod(_state.lod);
+  if(_state.occlusion != m_renderer.occlusion())
+  {
+    m_renderer.setOcclusion(_state.occlusion);
+  }
+  if(_state.wireframe != m_applied.wireframe)
+  {
+    glPolygonMode(GL_FRONT_AND_BACK, _state.wireframe ? GL_LINE : GL_FILL);
+  }
+  // a profile log started with GRID_PROFILE keeps running when the overlay goes
+  if(_state.overlay != m_applied.overlay && (_state.overlay || !m_renderer.profiler().logging()))
+  {
+    m_renderer.profiler().setEnabled(_state.overlay);
+  }
+  // presses folded into one snapshot cancel out in pairs
+  if((_state.traceToggles-m_applied.traceToggles) & 1u)
+  {
+    if(m_renderer.trace().enabled())
+    {
+      m_renderer.trace().stop();
+    }
+    else
+    {
+      m_renderer.trace().start("grid_trace.jsonl");
+    }
+  }
+  if((_state.captureToggles-m_applied.captureToggles) & 1u)
+  {
+    if(m_capture.enabled())
+    {
+      // the readbacks still in flight are waited for and the buffers released
+      m_capture.stop();
+    }
+    else
+    {
+      beginCapture("capture");
+    }
+  }
+  m_applied = _state;
+}
+
+uint32_t NGLScene::drawFrame(const SceneState &_state, uint32_t _dirty, GLuint _framebuffer, bool &o_drawn)
+{
+  o_drawn = false;
+  applyState(_state);
+  uint32_t dirty = _dirty;
+  // the render thread picks here, a cursor move that stays over the same cell needs no frame
+  if(m_threaded && _state.cursor && dirty != RenderScheduler::None && !pickCell(_state) &&
+     dirty == RenderScheduler::Pick)
+  {
+    dirty = RenderScheduler::None;
+  }
+  if(dirty == RenderScheduler::None || !_state.exposed)
+  {
+    return RenderScheduler::None;
+  }
+  m_renderer.resize(_state.win.width, _state.win.height);
+  m_renderer.render(mouseTransform(_state));
+  o_drawn = true;
+  uint32_t again = RenderScheduler::None;
+  if(m_capture.enabled())
+  {
+    // paintGL draws into the window's FBO while partial updates are on
+    m_capture.capture(_framebuffer, _state.win.width, _state.win.height);
+    again |= RenderScheduler::Capture;
+  }
+  if(_state.overlay)
+  {
+    // paintOverGL only runs when the window draws on the GUI thread
+    if(m_threaded)
+    {
+      QOpenGLPaintDevice device(_state.win.width, _state.win.height);
+      device.setDevicePixelRatio(_state.pixelRatio);
+      drawOverlay(&device, _state);
+    }
+    again |= RenderScheduler::Profile;
+  }
+  if(m_renderer.drawMode() == GridRenderer::DrawMode::Streamed && m_renderer.streamer().stats().missing > 0)
+  {
+    again |= RenderScheduler::Streaming;
+  }
+  // on demand rendering would otherwise leave cells hidden by the last view's depth missing until the next input
+  if(m_renderer.occlusionStale())
+  {
+    again |= RenderScheduler::Occlusion;
+  }
+  return again;
+}
 
+ngl::Mat4 NGLScene::mouseTransform(const SceneState &_state)
+{
   ngl::Mat4 rotX;
   ngl::Mat4 rotY;
   ngl::Mat4 mouseRotation;
-  rotX.rotateX(m_win.spinXFace); // rot around x axis and in angles according to mouse press down
-  rotY.rotateY(m_win.spinYFace);
+  rotX.rotateX(_state.win.spinXFace); // rot around x axis and in angles according to mouse press down
+  rotY.rotateY(_state.win.spinYFace);
   mouseRotation = rotY*rotX;
+  // pan and zoom from the mouse, in the streamed mode panning moves over the unbounded grid
+  mouseRotation.m_m[3][0] = _state.modelPos.m_x;
+  mouseRotation.m_m[3][1] = _state.modelPos.m_y;
+  mouseRotation.m_m[3][2] = _state.modelPos.m_z;
+  return mouseRotation;
+}
 
-  ngl::Transformation tx;
-  tx.setScale(0.2f, 0.2f, 0.2f);
+void NGLScene::updatePick(int _x, int _y)
+{
+  // the renderer works in framebuffer pixels, the events in device independent ones
+  const float ratio = static_cast<float>(devicePixelRatio());
+  m_state.cursor = true;
+  m_state.cursorX = _x*ratio;
+  m_state.cursorY = _y*ratio;
+  // the render thread picks when it takes the snapshot
+  if(m_threaded || pickCell(m_state))
+  {
+    requestRender(RenderScheduler::Pick);
+  }
+}
 
-  for(float z = -20.0f; z < 20.0f; z+=0.5)
+bool NGLScene::pickCell(const SceneState &_state)
+{
+  const GridPicker::Hit hit = m_renderer.pick(_state.cursorX, _state.cursorY, mouseTransform(_state));
+  const bool changed = hit.valid != m_picked.valid || hit.ix != m_picked.ix || hit.iz != m_picked.iz;
+  m_picked = hit;
+  if(changed)
+  {
+    m_renderer.setHighlight(hit);
+  }
+  if(_state.clicks != m_clicks)
   {
-    for(float x = -20.0f; x < 20.0f; x+=0.5)
+    m_clicks = _state.clicks;
+    if(m_picked.valid)
     {
-        ngl::Vec4 colour(z,z,x,1.0f);
-        colour.normalize();
-        tx.setPosition(x, 0.0f, z);
-        //tx.setRotation(45, 22, 18);
-
-        // initialise the MVP matrix everytime you draw
-        loadMatrixToShader( mouseRotation * tx.getMatrix(), colour); // (tx.getMatrix() * mouseRotation) // calling new loadMatrix - does local rotation on object
-        ngl::VAOPrimitives::instance()->draw("teapot"); // draw simple teapot
+      std::cout<<"Picked cell "<<m_picked.cell<<" ("<<m_picked.ix<<", "<<m_picked.iz<<") hit at ("
+               <<m_picked.point[0]<<", "<<m_picked.point[1]<<", "<<m_picked.point[2]<<") in "
+               <<m_picked.micros<<" us\n";
     }
   }
+  return changed;
+}
+
+void NGLScene::paintOverGL()
+{
+  if(m_state.overlay)
+  {
+    drawOverlay(this, m_state);
+  }
+}
+
+void NGLScene::drawOverlay(QPaintDevice *_device, const SceneState &_state)
+{
+  const FrameProfiler::Sample &sample = m_renderer.profiler().latest();
+  std::ostringstream text;
+  text<<std::fixed<<std::setprecision(3);
+  text<<"frame "<<sample.frame<<"   cpu "<<sample.cpuTotalMs<<" ms   gpu "<<sample.gpuTotalMs<<" ms\n";
+  for(uint32_t i = 0; i < FrameProfiler::StageCount; ++i)
+  {
+    text<<std::left<<std::setw(8)<<FrameProfiler::stageName(static_cast<FrameProfiler::Stage>(i))
+        <<std::right<<" cpu "<<std::setw(8)<<sample.cpuMs[i]<<"   gpu "<<std::setw(8)<<sample.gpuMs[i]<<"\n";
+  }
+  text<<"draw calls "<<sample.drawCalls<<"   triangles "<<sample.triangles
+      <<"   dropped "<<m_renderer.profiler().dropped();
+  if(m_capture.enabled())
+  {
+    const FrameCapture::Counters capture = m_capture.counters();
+    text<<"\ncapture written "<<capture.written<<"   queued "<<capture.queued<<"   dropped "<<capture.dropped;
+  }
+  if(m_renderer.drawMode() == GridRenderer::DrawMode::Streamed)
+  {
+    const TileStreamer::Stats &tiles = m_renderer.streamer().stats();
+    text<<"\ntiles "<<tiles.resident<<"/"<<m_renderer.streamer().capacity()<<"   missing "<<tiles.missing
+        <<"   queued "<<tiles.queued<<"   evicted "<<tiles.evicted<<"   "<<(tiles.bytes >> 20)<<" MB";
+  }
+  if(m_renderer.drawMode() == GridRenderer::DrawMode::Mixed)
+  {
+    const GridRenderer::FrameStats &stats = m_renderer.stats();
+    text<<"\nstate changes unsorted "<<stats.unsortedChanges.total()<<"   sorted "<<stats.sortedChanges.total()
+        <<" (programs "<<stats.sortedChanges.programs<<" meshes "<<stats.sortedChanges.meshes<<" materials "
+        <<stats.sortedChanges.materials<<")   sort "<<stats.sortMs<<" ms";
+  }
+  if(m_renderer.occlusion() && m_renderer.cullMode() == GridRenderer::CullMode::Gpu &&
+     m_renderer.drawMode() == GridRenderer::DrawMode::Instanced)
+  {
+    const GridRenderer::FrameStats &stats = m_renderer.stats();
+    text<<"\nsubmitted "<<m_renderer.grid().cellCount()<<"   visible "<<stats.instances<<"   occluded "<<stats.occluded;
+  }
+  const FrameLatency::Summary latency = m_latency.summary();
+  text<<"\nlatency "<<latency.median<<" ms   p99 "<<latency.p99<<"   gui stall "<<_state.stallMs<<" ms   max "
+      <<_state.stallMaxMs<<(m_threaded ? "   render thread" : "");
+  if(m_picked.valid)
+  {
+    text<<"\npicked cell ("<<m_picked.ix<<", "<<m_picked.iz<<")   "<<m_picked.micros<<" us   tested "<<m_picked.tested;
+  }
+
+  // the glyphs are quads, they would come out as outlines in wireframe
+  GLint polygonMode[2];
+  glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+  {
+    QPainter painter(_device);
+    QFont font("Monospace");
+    font.setStyleHint(QFont::TypeWriter);
+    painter.setFont(font);
+    const QRect area(10, 10, static_cast<int>(_state.win.width/_state.pixelRatio)-20,
+                     static_cast<int>(_state.win.height/_state.pixelRatio)-20);
+    const QString lines = QString::fromStdString(text.str());
+    QRect bounds = painter.boundingRect(area, Qt::AlignLeft | Qt::AlignTop, lines);
+    painter.fillRect(bounds.adjusted(-4, -4, 4, 4), QColor(0, 0, 0, 160));
+    painter.setPen(Qt::white);
+    painter.drawText(area, Qt::AlignLeft | Qt::AlignTop, lines);
+  }
+  glPolygonMode(GL_FRONT_AND_BACK, static_cast<GLenum>(polygonMode[0]));
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -115,18 +467,57 @@ void NGLScene::keyPressEvent(QKeyEvent *_event)
   // escape key to quite
   case Qt::Key_Escape : QGuiApplication::exit(EXIT_SUCCESS); break;
   case Qt::Key_Space :
-      m_win.spinXFace=0;
-      m_win.spinYFace=0;
-      m_modelPos.set(ngl::Vec3::zero());
-
+      m_state.win.spinXFace=0;
+      m_state.win.spinYFace=0;
+      m_state.modelPos.set(ngl::Vec3::zero());
+      requestRender(RenderScheduler::Rotation | RenderScheduler::Position);
+  break;
+  // the settings below are applied to the renderer by the side drawing the next frame
+  case Qt::Key_W : m_state.wireframe=true; requestRender(RenderScheduler::Settings); break; // wireframe draw
+  case Qt::Key_S : m_state.wireframe=false; requestRender(RenderScheduler::Settings); break; // solid draw
+  case Qt::Key_I : // cycle the per draw, instanced, procedural, streamed and mixed paths
+  {
+      static const char *names[] = { "per draw", "instanced", "procedural", "streamed", "mixed" };
+      int mode = (static_cast<int>(m_state.drawMode)+1)%5;
+      m_state.drawMode = static_cast<GridRenderer::DrawMode>(mode);
+      std::cout<<"Draw mode "<<names[mode]<<"\n";
+      requestRender(RenderScheduler::Settings);
+  }
+  break;
+  case Qt::Key_C : // cycle the culling none -> cpu -> gpu
+  {
+      static const char *names[] = { "none", "cpu", "gpu" };
+      int mode = (static_cast<int>(m_state.cullMode)+1)%3;
+      m_state.cullMode = static_cast<GridRenderer::CullMode>(mode);
+      std::cout<<"Cull mode "<<names[mode]<<"\n";
+      requestRender(RenderScheduler::Settings);
+  }
+  break;
+  case Qt::Key_O : // toggle occlusion culling against the last frame's depth, gpu culled instancing only
+      m_state.occlusion = !m_state.occlusion;
+      std::cout<<"Occlusion "<<(m_state.occlusion ? "on" : "off")<<"\n";
+      requestRender(RenderScheduler::Settings);
+  break;
+  case Qt::Key_L : // toggle the distance based level of detail
+      m_state.lod = !m_state.lod;
+      std::cout<<"Level of detail "<<(m_state.lod ? "on" : "off")<<"\n";
+      requestRender(RenderScheduler::Settings);
+  break;
+  case Qt::Key_P : // toggle the profiler overlay
+      m_state.overlay = !m_state.overlay;
+      requestRender(RenderScheduler::Profile);
+  break;
+  case Qt::Key_R : // start / stop recording frames into capture/
+      ++m_state.captureToggles;
+      requestRender(RenderScheduler::Capture);
+  break;
+  case Qt::Key_T : // toggle the per cell frame trace
+      ++m_state.traceToggles;
+      requestRender(RenderScheduler::Settings);
   break;
-  case Qt::Key_W : glPolygonMode(GL_FRONT_AND_BACK, GL_LINE); break; // wireframe draw
-  case Qt::Key_S : glPolygonMode(GL_FRONT_AND_BACK, GL_FILL); break; // solid draw
 
 
   default : break;
   }
-  // finally update the GLWindow and re-draw
-
-    update();
+  // each case asks for the frame it needs, unhandled keys no longer repaint
 }
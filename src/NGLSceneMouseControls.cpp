@@ -8,27 +8,38 @@ void NGLScene::mouseMoveEvent( QMouseEvent* _event )
   // note the method buttons() is the button state when event was called
   // that is different from button() which is used to check which button was
   // pressed when the mousePress/Release event is generated
-  if ( m_win.rotate && _event->buttons() == Qt::LeftButton )
+  if ( m_state.win.rotate && _event->buttons() == Qt::LeftButton )
   {
-    int diffx = _event->x() - m_win.origX;
-    int diffy = _event->y() - m_win.origY;
-    m_win.spinXFace += static_cast<int>( 0.5f * diffy );
-    m_win.spinYFace += static_cast<int>( 0.5f * diffx );
-    m_win.origX = _event->x();
-    m_win.origY = _event->y();
-    update();
+    int diffx = _event->x() - m_state.win.origX;
+    int diffy = _event->y() - m_state.win.origY;
+    int spinX = static_cast<int>( 0.5f * diffy );
+    int spinY = static_cast<int>( 0.5f * diffx );
+    m_state.win.spinXFace += spinX;
+    m_state.win.spinYFace += spinY;
+    m_state.win.origX = _event->x();
+    m_state.win.origY = _event->y();
+    // moves under a degree do not change the rotation
+    if ( spinX != 0 || spinY != 0 )
+    {
+      requestRender( RenderScheduler::Rotation );
+    }
   }
   // right mouse translate code
-  else if ( m_win.translate && _event->buttons() == Qt::RightButton )
+  else if ( m_state.win.translate && _event->buttons() == Qt::RightButton )
   {
-    int diffX      = static_cast<int>( _event->x() - m_win.origXPos );
-    int diffY      = static_cast<int>( _event->y() - m_win.origYPos );
-    m_win.origXPos = _event->x();
-    m_win.origYPos = _event->y();
-    m_modelPos.m_x += INCREMENT * diffX;
-    m_modelPos.m_y -= INCREMENT * diffY;
-    update();
+    int diffX      = static_cast<int>( _event->x() - m_state.win.origXPos );
+    int diffY      = static_cast<int>( _event->y() - m_state.win.origYPos );
+    m_state.win.origXPos = _event->x();
+    m_state.win.origYPos = _event->y();
+    m_state.modelPos.m_x += INCREMENT * diffX;
+    m_state.modelPos.m_y -= INCREMENT * diffY;
+    if ( diffX != 0 || diffY != 0 )
+    {
+      requestRender( RenderScheduler::Position );
+    }
   }
+  // hovering, or the grid moving under the cursor, changes the picked cell
+  updatePick( _event->x(), _event->y() );
 }
 
 
@@ -39,16 +50,19 @@ void NGLScene::mousePressEvent( QMouseEvent* _event )
   // store the value where the maouse was clicked (x,y) and set the Rotate flag to true
   if ( _event->button() == Qt::LeftButton )
   {
-    m_win.origX  = _event->x();
-    m_win.origY  = _event->y();
-    m_win.rotate = true;
+    m_state.win.origX  = _event->x();
+    m_state.win.origY  = _event->y();
+    m_state.win.rotate = true;
+    // the side drawing the frame picks and reports the clicked cell
+    ++m_state.clicks;
+    updatePick( _event->x(), _event->y() );
   }
   // right mouse translate mode
   else if ( _event->button() == Qt::RightButton )
   {
-    m_win.origXPos  = _event->x();
-    m_win.origYPos  = _event->y();
-    m_win.translate = true;
+    m_state.win.origXPos  = _event->x();
+    m_state.win.origYPos  = _event->y();
+    m_state.win.translate = true;
   }
 }
 
@@ -59,12 +73,12 @@ void NGLScene::mouseReleaseEvent( QMouseEvent* _event )
   // we then set Rotate to false
   if ( _event->button() == Qt::LeftButton )
   {
-    m_win.rotate = false;
+    m_state.win.rotate = false;
   }
   // right mouse translate mode
   if ( _event->button() == Qt::RightButton )
   {
-    m_win.translate = false;
+    m_state.win.translate = false;
   }
 }
 
@@ -75,11 +89,16 @@ void NGLScene::wheelEvent( QWheelEvent* _event )
   // check the diff of the wheel position (0 means no change)
   if ( _event->delta() > 0 )
   {
-    m_modelPos.m_z += ZOOM;
+    m_state.modelPos.m_z += ZOOM;
   }
   else if ( _event->delta() < 0 )
   {
-    m_modelPos.m_z -= ZOOM;
+    m_state.modelPos.m_z -= ZOOM;
   }
-  update();
+  else
+  {
+    return;
+  }
+  requestRender( RenderScheduler::Position );
+  updatePick( _event->x(), _event->y() );
 }
@@ -0,0 +1,48 @@
+#include "PoolAllocator.h"
+#include <algorithm>
+
+constexpr size_t NodePool::NodesPerChunk;
+
+NodePool::~NodePool()
+{
+  for(void *chunk : m_chunks)
+  {
+    ::operator delete(chunk);
+  }
+}
+
+bool NodePool::serves(size_t _bytes)
+{
+  if(m_nodeBytes == 0)
+  {
+    // room for the free list link, rounded so every node stays aligned for any standard type
+    const size_t align = alignof(std::max_align_t);
+    m_nodeBytes = (std::max(_bytes, sizeof(FreeNode))+align-1)/align*align;
+  }
+  return _bytes <= m_nodeBytes;
+}
+
+void *NodePool::allocate()
+{
+  if(m_free == nullptr)
+  {
+    char *chunk = static_cast<char *>(::operator new(m_nodeBytes*NodesPerChunk));
+    m_chunks.push_back(chunk);
+    for(size_t i = NodesPerChunk; i > 0; --i)
+    {
+      FreeNode *node = reinterpret_cast<FreeNode *>(chunk+(i-1)*m_nodeBytes);
+      node->next = m_free;
+      m_free = node;
+    }
+  }
+  FreeNode *node = m_free;
+  m_free = node->next;
+  return node;
+}
+
+void NodePool::deallocate(void *_node)
+{
+  FreeNode *node = static_cast<FreeNode *>(_node);
+  node->next = m_free;
+  m_free = node;
+}
@@ -0,0 +1,352 @@
+#include "ProgramCache.h"
+#include <QDir>
+#include <QOpenGLContext>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+  // identifies a binary file written by this class, bump when the header changes
+  constexpr char Magic[8] = {'G', 'R', 'I', 'D', 'P', 'R', 'G', '1'};
+  struct Header
+  {
+    char magic[8];
+    uint64_t key;
+    uint32_t format;
+    uint32_t size;
+  };
+
+  /// 64 bit FNV-1a, folded over each string including its terminator so "ab","c" and "a","bc" differ
+  uint64_t hash(uint64_t _seed, const std::string &_text)
+  {
+    uint64_t h = _seed;
+    for(size_t i = 0; i <= _text.size(); ++i)
+    {
+      h ^= static_cast<unsigned char>(_text.c_str()[i]);
+      h *= 1099511628211ull;
+    }
+    return h;
+  }
+
+  std::string glString(GLenum _name)
+  {
+    const GLubyte *value = glGetString(_name);
+    return value != nullptr ? reinterpret_cast<const char *>(value) : "";
+  }
+
+  bool readSource(const char *_path, std::string &o_text)
+  {
+    std::ifstream file(_path);
+    if(!file.is_open())
+    {
+      std::cerr<<"unable to open "<<_path<<"\n";
+      return false;
+    }
+    std::stringstream source;
+    source<<file.rdbuf();
+    o_text = source.str();
+    return true;
+  }
+
+  /// the defines go straight after the #version line, which must stay first
+  std::string addDefines(const std::string &_source, const std::vector<std::string> &_defines)
+  {
+    if(_defines.empty())
+    {
+      return _source;
+    }
+    size_t split = 0;
+    if(_source.compare(0, 8, "#version") == 0)
+    {
+      split = _source.find('\n');
+      split = split == std::string::npos ? _source.size() : split+1;
+    }
+    std::string text = _source.substr(0, split);
+    if(split == _source.size() && (text.empty() || text.back() != '\n'))
+    {
+      text += '\n';
+    }
+    for(const auto &define : _defines)
+    {
+      text += "#define "+define+"\n";
+    }
+    return text+_source.substr(split);
+  }
+
+  double elapsedMs(std::chrono::steady_clock::time_point _start)
+  {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-_start).count();
+  }
+}
+
+ProgramCache::ProgramCache(const std::string &_directory) :
+  m_directory(_directory)
+{
+  m_driver = glString(GL_VENDOR)+"\n"+glString(GL_RENDERER)+"\n"+glString(GL_VERSION);
+  GLint formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  if(formats == 0)
+  {
+    // the driver can't give binaries back, so there is nothing to keep
+    m_directory.clear();
+  }
+  if(!m_directory.empty() && !QDir().mkpath(QString::fromStdString(m_directory)))
+  {
+    std::cerr<<"unable to create the program cache "<<m_directory<<"\n";
+    m_directory.clear();
+  }
+  enableParallelCompile();
+}
+
+ProgramCache::~ProgramCache()
+{
+  for(auto &entry : m_entries)
+  {
+    if(!entry.taken)
+    {
+      for(auto shader : entry.shaders)
+      {
+        glDeleteShader(shader);
+      }
+      glDeleteProgram(entry.program);
+    }
+  }
+}
+
+void ProgramCache::enableParallelCompile()
+{
+  QOpenGLContext *context = QOpenGLContext::currentContext();
+  if(context == nullptr)
+  {
+    return;
+  }
+  // both extensions share the entry point signature and the completion status enum
+  using MaxThreads = void (*)(GLuint);
+  MaxThreads maxThreads = nullptr;
+  if(context->hasExtension("GL_KHR_parallel_shader_compile"))
+  {
+    maxThreads = reinterpret_cast<MaxThreads>(context->getProcAddress("glMaxShaderCompilerThreadsKHR"));
+  }
+  else if(context->hasExtension("GL_ARB_parallel_shader_compile"))
+  {
+    maxThreads = reinterpret_cast<MaxThreads>(context->getProcAddress("glMaxShaderCompilerThreadsARB"));
+  }
+  if(maxThreads != nullptr)
+  {
+    // let the driver pick how many threads
+    maxThreads(0xFFFFFFFF);
+    m_stats.parallel = true;
+  }
+}
+
+ProgramCache::Handle ProgramCache::request(const std::string &_name, const std::vector<Stage> &_stages,
+                                           const std::vector<std::string> &_defines)
+{
+  Entry entry;
+  entry.name = _name;
+  entry.start = Clock::now();
+
+  std::vector<std::string> sources;
+  uint64_t key = hash(14695981039346656037ull, m_driver);
+  bool readable = true;
+  for(const auto &stage : _stages)
+  {
+    std::string source;
+    readable = readSource(stage.path, source) && readable;
+    sources.push_back(addDefines(source, _defines));
+    key = hash(key, std::to_string(stage.type));
+    key = hash(key, sources.back());
+  }
+  entry.key = key;
+  if(!readable)
+  {
+    m_entries.push_back(entry);
+    return m_entries.size()-1;
+  }
+
+  if(!m_directory.empty())
+  {
+    std::ostringstream file;
+    file<<m_directory<<"/"<<_name<<"-"<<std::hex<<std::setw(16)<<std::setfill('0')<<key<<".bin";
+    entry.file = file.str();
+    entry.hit = load(entry);
+  }
+  if(!entry.hit)
+  {
+    // no status queries here, they would wait for the driver to finish
+    entry.program = glCreateProgram();
+    for(size_t i = 0; i < _stages.size(); ++i)
+    {
+      GLuint shader = glCreateShader(_stages[i].type);
+      const char *code = sources[i].c_str();
+      glShaderSource(shader, 1, &code, nullptr);
+      glCompileShader(shader);
+      glAttachShader(entry.program, shader);
+      entry.shaders.push_back(shader);
+    }
+    if(!m_directory.empty())
+    {
+      glProgramParameteri(entry.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(entry.program);
+  }
+  m_entries.push_back(entry);
+  return m_entries.size()-1;
+}
+
+bool ProgramCache::load(Entry &_entry) const
+{
+  std::ifstream file(_entry.file, std::ios::binary);
+  Header header;
+  if(!file.is_open() || !file.read(reinterpret_cast<char *>(&header), sizeof(Header)) ||
+     std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.key != _entry.key)
+  {
+    return false;
+  }
+  std::vector<char> binary(header.size);
+  if(!file.read(binary.data(), header.size))
+  {
+    return false;
+  }
+  GLuint program = glCreateProgram();
+  glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(header.size));
+  GLint status = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &status);
+  if(status != GL_TRUE)
+  {
+    // usually a driver update the version string didn't show, the rebuilt program overwrites the file
+    glDeleteProgram(program);
+    return false;
+  }
+  _entry.program = program;
+  return true;
+}
+
+void ProgramCache::store(const Entry &_entry) const
+{
+  GLint length = 0;
+  glGetProgramiv(_entry.program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if(length <= 0)
+  {
+    return;
+  }
+  std::vector<char> binary(static_cast<size_t>(length));
+  Header header;
+  std::memcpy(header.magic, Magic, sizeof(Magic));
+  header.key = _entry.key;
+  GLenum format = 0;
+  glGetProgramBinary(_entry.program, length, nullptr, &format, binary.data());
+  header.format = format;
+  header.size = static_cast<uint32_t>(length);
+  // write beside the final name and rename so another instance never reads half a file
+  const std::string partial = _entry.file+".part";
+  {
+    std::ofstream file(partial, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+    file.write(binary.data(), length);
+    if(!file)
+    {
+      std::cerr<<"unable to write "<<partial<<"\n";
+      return;
+    }
+  }
+  QDir().remove(QString::fromStdString(_entry.file));
+  QDir().rename(QString::fromStdString(partial), QString::fromStdString(_entry.file));
+}
+
+bool ProgramCache::ready(Handle _handle) const
+{
+  const Entry &entry = m_entries[_handle];
+  if(entry.hit || entry.program == 0 || !m_stats.parallel)
+  {
+    return true;
+  }
+  GLint done = GL_FALSE;
+  glGetProgramiv(entry.program, GL_COMPLETION_STATUS_KHR, &done);
+  return done == GL_TRUE;
+}
+
+GLuint ProgramCache::take(Handle _handle)
+{
+  Entry &entry = m_entries[_handle];
+  if(entry.taken)
+  {
+    return 0;
+  }
+  entry.taken = true;
+  if(entry.program == 0)
+  {
+    ++m_stats.failures;
+    return 0;
+  }
+  if(!entry.hit)
+  {
+    // the first status query waits for the driver's compiler threads
+    GLint status = GL_FALSE;
+    glGetProgramiv(entry.program, GL_LINK_STATUS, &status);
+    if(status != GL_TRUE)
+    {
+      char log[4096];
+      std::cerr<<"unable to build "<<entry.name<<"\n";
+      for(auto shader : entry.shaders)
+      {
+        GLint compiled = GL_FALSE;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+        if(compiled != GL_TRUE)
+        {
+          glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+          std::cerr<<log<<"\n";
+        }
+      }
+      glGetProgramInfoLog(entry.program, sizeof(log), nullptr, log);
+      std::cerr<<log<<"\n";
+    }
+    for(auto shader : entry.shaders)
+    {
+      glDetachShader(entry.program, shader);
+      glDeleteShader(shader);
+    }
+    entry.shaders.clear();
+    if(status != GL_TRUE)
+    {
+      glDeleteProgram(entry.program);
+      entry.program = 0;
+      ++m_stats.failures;
+      return 0;
+    }
+    if(!entry.file.empty())
+    {
+      store(entry);
+    }
+  }
+  entry.ms = elapsedMs(entry.start);
+  if(entry.hit)
+  {
+    ++m_stats.hits;
+    m_stats.loadMs += entry.ms;
+  }
+  else
+  {
+    ++m_stats.misses;
+    m_stats.compileMs += entry.ms;
+  }
+  return entry.program;
+}
+
+void ProgramCache::report(std::ostream &_out) const
+{
+  _out<<"program cache "<<(m_directory.empty() ? std::string("off") : m_directory)
+      <<(m_stats.parallel ? ", parallel compile" : "")<<"\n";
+  for(const auto &entry : m_entries)
+  {
+    if(entry.taken && entry.program != 0)
+    {
+      _out<<"  "<<entry.name<<(entry.hit ? " hit, loaded in " : " miss, compiled in ")<<entry.ms<<" ms\n";
+    }
+  }
+  _out<<"  "<<m_stats.hits<<" hits "<<m_stats.loadMs<<" ms, "<<m_stats.misses<<" misses "
+      <<m_stats.compileMs<<" ms, "<<m_stats.failures<<" failed\n";
+}
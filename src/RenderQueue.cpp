@@ -0,0 +1,129 @@
+#include "RenderQueue.h"
+#include <algorithm>
+#include <cstring>
+
+constexpr uint32_t RenderQueue::ShaderBits;
+constexpr uint32_t RenderQueue::MeshBits;
+constexpr uint32_t RenderQueue::MaterialBits;
+constexpr uint32_t RenderQueue::DepthBits;
+
+namespace
+{
+// 8 bit digits, so 8 passes over a 64 bit key at most
+constexpr uint32_t RadixBits = 8;
+constexpr uint32_t RadixSize = 1u << RadixBits;
+constexpr uint32_t RadixPasses = 64/RadixBits;
+}
+
+uint64_t RenderQueue::key(uint32_t _state, float _depth)
+{
+  uint32_t bits;
+  std::memcpy(&bits, &_depth, sizeof(bits));
+  // flipping every bit of a negative float and only the sign of a positive one makes the unsigned
+  // order of the bits the order of the floats
+  bits ^= (bits & 0x80000000u) != 0 ? 0xffffffffu : 0x80000000u;
+  return (static_cast<uint64_t>(_state) << DepthBits) | bits;
+}
+
+void RenderQueue::reset(size_t _count, FrameArena &_arena)
+{
+  m_arena = &_arena;
+  m_count = _count;
+  m_packets = _arena.allocate<Packet>(_count);
+  m_scratch = _arena.allocate<Packet>(_count);
+  m_batches = nullptr;
+  m_batchCount = 0;
+}
+
+RenderQueue::StateChanges RenderQueue::countChanges(const Packet *_packets, size_t _count)
+{
+  StateChanges changes;
+  if(_count == 0)
+  {
+    return changes;
+  }
+  changes.programs = changes.meshes = changes.materials = 1;
+  for(size_t i = 1; i < _count; ++i)
+  {
+    const uint64_t previous = _packets[i-1].key;
+    const uint64_t current = _packets[i].key;
+    changes.programs += shader(previous) != shader(current) ? 1 : 0;
+    changes.meshes += mesh(previous) != mesh(current) ? 1 : 0;
+    changes.materials += material(previous) != material(current) ? 1 : 0;
+  }
+  return changes;
+}
+
+void RenderQueue::sort()
+{
+  m_unsorted = countChanges(m_packets, m_count);
+  m_passes = 0;
+  const size_t count = m_count;
+  if(count > 1)
+  {
+    // one read of the keys builds the histogram of every digit
+    uint32_t histograms[RadixPasses][RadixSize];
+    std::memset(histograms, 0, sizeof(histograms));
+    for(size_t i = 0; i < count; ++i)
+    {
+      const Packet &packet = m_packets[i];
+      for(uint32_t pass = 0; pass < RadixPasses; ++pass)
+      {
+        ++histograms[pass][(packet.key >> (pass*RadixBits)) & (RadixSize-1)];
+      }
+    }
+    Packet *from = m_packets;
+    Packet *to = m_scratch;
+    for(uint32_t pass = 0; pass < RadixPasses; ++pass)
+    {
+      const uint32_t shift = pass*RadixBits;
+      uint32_t *histogram = histograms[pass];
+      // a digit every key shares would only copy the packets, which is most of the state bits
+      if(histogram[(from[0].key >> shift) & (RadixSize-1)] == count)
+      {
+        continue;
+      }
+      uint32_t offset = 0;
+      for(uint32_t digit = 0; digit < RadixSize; ++digit)
+      {
+        const uint32_t packets = histogram[digit];
+        histogram[digit] = offset;
+        offset += packets;
+      }
+      // stable, so the lower digits sorted by earlier passes keep their order
+      for(size_t i = 0; i < count; ++i)
+      {
+        to[histogram[(from[i].key >> shift) & (RadixSize-1)]++] = from[i];
+      }
+      std::swap(from, to);
+      ++m_passes;
+    }
+    if(from != m_packets)
+    {
+      std::swap(m_packets, m_scratch);
+    }
+  }
+
+  // counted first so the batches are one exactly sized arena array
+  m_batchCount = 0;
+  for(size_t i = 0; i < count; ++i)
+  {
+    m_batchCount += i == 0 || (m_packets[i].key >> DepthBits) != (m_packets[i-1].key >> DepthBits) ? 1 : 0;
+  }
+  m_batches = m_arena != nullptr ? m_arena->allocate<Batch>(m_batchCount) : nullptr;
+  size_t batch = 0;
+  size_t first = 0;
+  while(first < count)
+  {
+    const uint64_t state = m_packets[first].key >> DepthBits;
+    size_t end = first+1;
+    while(end < count && (m_packets[end].key >> DepthBits) == state)
+    {
+      ++end;
+    }
+    const uint64_t key = m_packets[first].key;
+    m_batches[batch++] = { shader(key), mesh(key), material(key), static_cast<uint32_t>(first), static_cast<uint32_t>(end-first) };
+    first = end;
+  }
+  m_sorted = countChanges(m_packets, m_count);
+}
@@ -0,0 +1,34 @@
+#include "RenderScheduler.h"
+
+bool RenderScheduler::invalidate(uint32_t _dirty)
+{
+  if(_dirty == None)
+  {
+    return false;
+  }
+  m_dirty |= _dirty;
+  ++m_counters.requested;
+  if(m_pending)
+  {
+    ++m_counters.coalesced;
+    return false;
+  }
+  m_pending = true;
+  return true;
+}
+
+uint32_t RenderScheduler::beginFrame()
+{
+  m_pending = false;
+  const uint32_t dirty = m_dirty;
+  m_dirty = None;
+  if(dirty == None)
+  {
+    ++m_counters.skipped;
+  }
+  else
+  {
+    ++m_counters.rendered;
+  }
+  return dirty;
+}
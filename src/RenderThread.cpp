@@ -0,0 +1,128 @@
+#include "RenderThread.h"
+#include <QThread>
+#include <QWindow>
+#include <iostream>
+
+namespace
+{
+// longest the thread waits for the GPU to reach a swap before carrying on, in nanoseconds
+constexpr GLuint64 SwapTimeout = 100000000ull;
+}
+
+RenderThread::~RenderThread()
+{
+  stop();
+}
+
+bool RenderThread::supported()
+{
+  return QOpenGLContext::supportsThreadedOpenGL();
+}
+
+void RenderThread::start(QWindow *_window, const QSurfaceFormat &_format, const Callbacks &_callbacks)
+{
+  if(running())
+  {
+    return;
+  }
+  m_window = _window;
+  m_format = _format;
+  m_callbacks = _callbacks;
+  m_owner = QThread::currentThread();
+  m_running.store(true, std::memory_order_relaxed);
+  m_thread = std::thread(&RenderThread::run, this);
+}
+
+void RenderThread::stop()
+{
+  if(!running())
+  {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_running.store(false, std::memory_order_relaxed);
+  }
+  m_wake.notify_one();
+  m_thread.join();
+  if(m_context)
+  {
+    m_context->makeCurrent(m_window);
+  }
+}
+
+void RenderThread::publish()
+{
+  if(m_snapshots.publish())
+  {
+    ++m_coalesced;
+  }
+  // the snapshot is already handed over, the lock only closes the gap between the thread finding
+  // nothing pending and going to sleep
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+  }
+  m_wake.notify_one();
+}
+
+RenderThread::Counters RenderThread::counters() const
+{
+  Counters counters = m_counters;
+  counters.coalesced = m_coalesced;
+  return counters;
+}
+
+void RenderThread::run()
+{
+  // the context belongs to this thread from its creation
+  m_context.reset(new QOpenGLContext);
+  m_context->setFormat(m_format);
+  if(!m_context->create() || !m_context->makeCurrent(m_window))
+  {
+    std::cerr<<"RenderThread unable to create a context for the window\n";
+    m_context.reset();
+    return;
+  }
+  m_callbacks.initialize();
+  const GLuint framebuffer = m_context->defaultFramebufferObject();
+  uint32_t again = RenderScheduler::None;
+  for(;;)
+  {
+    // only sleep when the last frame did not ask for another
+    if(again == RenderScheduler::None)
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_wake.wait(lock, [this]{ return m_snapshots.pending() || !m_running.load(std::memory_order_relaxed); });
+    }
+    if(!m_running.load(std::memory_order_relaxed))
+    {
+      break;
+    }
+    const bool fresh = m_snapshots.take();
+    const SceneState &state = m_snapshots.front();
+    uint32_t dirty = again;
+    if(fresh)
+    {
+      m_consumed.store(state.sequence, std::memory_order_release);
+      ++m_counters.taken;
+      dirty |= state.dirty;
+    }
+    bool drawn = false;
+    again = m_callbacks.frame(state, dirty, framebuffer, drawn);
+    if(!drawn)
+    {
+      ++m_counters.skipped;
+      continue;
+    }
+    // blocks for the swap interval where the driver does, the fence then keeps this thread from getting
+    // a frame ahead of the display where it does not
+    m_context->swapBuffers(m_window);
+    GLsync swapped = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glClientWaitSync(swapped, GL_SYNC_FLUSH_COMMANDS_BIT, SwapTimeout);
+    glDeleteSync(swapped);
+    ++m_counters.rendered;
+    m_callbacks.presented(state, fresh);
+  }
+  m_context->doneCurrent();
+  m_context->moveToThread(m_owner);
+}
@@ -0,0 +1,25 @@
+#include "ShaderProgram.h"
+#include <iostream>
+
+GLuint ShaderProgram::s_current=0;
+
+bool ShaderProgram::use() const
+{
+  if(s_current == m_id)
+  {
+    return false;
+  }
+  glUseProgram(m_id);
+  s_current = m_id;
+  return true;
+}
+
+GLint ShaderProgram::location(const char *_name) const
+{
+  GLint location = glGetUniformLocation(m_id, _name);
+  if(location < 0)
+  {
+    std::cerr<<"uniform "<<_name<<" not found in program "<<m_id<<"\n";
+  }
+  return location;
+}
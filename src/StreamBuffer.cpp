@@ -0,0 +1,122 @@
+#include "StreamBuffer.h"
+#include <chrono>
+#include <cstring>
+
+constexpr uint32_t StreamBuffer::Regions;
+
+StreamBuffer::~StreamBuffer()
+{
+  for(GLsync &fence : m_fences)
+  {
+    glDeleteSync(fence);
+  }
+  for(const Retired &retired : m_retired)
+  {
+    glDeleteBuffers(1, &retired.buffer);
+  }
+  glDeleteBuffers(1, &m_buffer);
+}
+
+void StreamBuffer::create(size_t _regionBytes)
+{
+  GLint alignment = 0;
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  if(alignment > 0)
+  {
+    m_uniformAlignment = static_cast<size_t>(alignment);
+  }
+  allocateStorage(_regionBytes);
+}
+
+void StreamBuffer::allocateStorage(size_t _regionBytes)
+{
+  if(m_buffer != 0)
+  {
+    m_retired.push_back({m_buffer, m_frame});
+  }
+  // the fences belong to the old buffer, the new one is not in use anywhere yet
+  for(GLsync &fence : m_fences)
+  {
+    glDeleteSync(fence);
+    fence = nullptr;
+  }
+  m_regionBytes = _regionBytes;
+  const GLsizeiptr totalBytes = static_cast<GLsizeiptr>(m_regionBytes*Regions);
+  const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  glGenBuffers(1, &m_buffer);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+  glBufferStorage(GL_COPY_WRITE_BUFFER, totalBytes, nullptr, flags);
+  m_data = static_cast<char *>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, totalBytes, flags));
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  m_head = 0;
+}
+
+void StreamBuffer::beginFrame()
+{
+  ++m_frame;
+  m_region = (m_region+1)%Regions;
+  m_head = 0;
+  GLsync &fence = m_fences[m_region];
+  if(fence != nullptr)
+  {
+    // only count it as a wait if the GPU really is behind, the usual case returns straight away
+    if(glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+    {
+      ++m_counters.fenceWaits;
+      auto start = std::chrono::steady_clock::now();
+      while(glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+      {
+      }
+      m_counters.fenceWaitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()-start).count();
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+  }
+  // waiting on the region Regions frames back means the GPU is done with anything retired before it
+  while(!m_retired.empty() && m_retired.front().frame+Regions <= m_frame)
+  {
+    glDeleteBuffers(1, &m_retired.front().buffer);
+    m_retired.erase(m_retired.begin());
+  }
+}
+
+void StreamBuffer::endFrame()
+{
+  glDeleteSync(m_fences[m_region]);
+  m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+StreamBuffer::Allocation StreamBuffer::allocate(size_t _bytes, size_t _alignment)
+{
+  size_t offset = (m_head+_alignment-1) & ~(_alignment-1);
+  if(offset+_bytes > m_regionBytes)
+  {
+    ++m_counters.grows;
+    size_t regionBytes = m_regionBytes*2;
+    while(regionBytes < _bytes+_alignment)
+    {
+      regionBytes *= 2;
+    }
+    allocateStorage(regionBytes);
+    offset = 0;
+  }
+  m_head = offset+_bytes;
+  Allocation allocation;
+  allocation.buffer = m_buffer;
+  allocation.offset = static_cast<GLintptr>(m_region*m_regionBytes+offset);
+  allocation.data = m_data+allocation.offset;
+  allocation.size = static_cast<GLsizeiptr>(_bytes);
+  return allocation;
+}
+
+StreamBuffer::Allocation StreamBuffer::upload(const void *_data, size_t _bytes, size_t _alignment)
+{
+  Allocation allocation = allocate(_bytes, _alignment);
+  std::memcpy(allocation.data, _data, _bytes);
+  return allocation;
+}
+
+void StreamBuffer::bindRange(GLenum _target, GLuint _index, const Allocation &_allocation)
+{
+  glBindBufferRange(_target, _index, _allocation.buffer, _allocation.offset, _allocation.size);
+}
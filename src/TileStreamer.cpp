@@ -0,0 +1,312 @@
+#include "TileStreamer.h"
+#include "StreamBuffer.h"
+#include <algorithm>
+#include <cmath>
+
+constexpr uint32_t TileStreamer::TileSize;
+constexpr uint32_t TileStreamer::TileCells;
+constexpr size_t TileStreamer::TileBytes;
+constexpr uint32_t TileStreamer::MaxUploads;
+
+TileStreamer::TileStreamer(unsigned int _threads) :
+  m_entries(0, std::hash<uint64_t>(), std::equal_to<uint64_t>(), PoolAllocator<std::pair<const uint64_t, Entry>>(&m_entryPool)),
+  m_lru(PoolAllocator<uint64_t>(&m_lruPool)),
+  m_requested(0, std::hash<uint64_t>(), std::equal_to<uint64_t>(), PoolAllocator<uint64_t>(&m_requestedPool))
+{
+  m_uploading.reserve(MaxUploads);
+  m_uploads.reserve(MaxUploads);
+  m_spare.reserve(MaxUploads);
+  setBudget(m_budget);
+  m_threadCount = _threads != 0 ? _threads : std::max(1u, std::thread::hardware_concurrency()/4);
+}
+
+TileStreamer::~TileStreamer()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_running = false;
+  }
+  m_wake.notify_all();
+  for(auto &thread : m_threads)
+  {
+    thread.join();
+  }
+}
+
+void TileStreamer::setLayout(float _step, float _scale)
+{
+  if(_step != m_step || _scale != m_scale)
+  {
+    m_step = _step;
+    m_scale = _scale;
+    clear();
+  }
+}
+
+void TileStreamer::setBudget(size_t _bytes)
+{
+  m_budget = _bytes;
+  const uint32_t capacity = static_cast<uint32_t>(_bytes/TileBytes);
+  // the owner keeps its buffer when the capacity is unchanged, so frames in flight may still read every slot
+  if(capacity == m_capacity)
+  {
+    return;
+  }
+  m_capacity = capacity;
+  clear();
+  // the owner reallocates its buffer for the new capacity so every slot is free straight away
+  m_retired.clear();
+  m_freeSlots.clear();
+  for(uint32_t slot = m_capacity; slot > 0; --slot)
+  {
+    m_freeSlots.push_back(slot-1);
+  }
+  // the map never holds more than capacity tiles so it never rehashes while streaming
+  m_entries.reserve(m_capacity);
+  m_visible.reserve(m_capacity);
+}
+
+void TileStreamer::clear()
+{
+  ++m_generation;
+  // frames in flight may still read the resident slots
+  for(const auto &entry : m_entries)
+  {
+    m_retired.push_back({entry.second.tile.slot, m_frame});
+  }
+  m_entries.clear();
+  m_lru.clear();
+  for(const Built &built : m_ready)
+  {
+    m_requested.erase(built.request.key);
+  }
+  m_ready.clear();
+  m_visible.clear();
+  m_uploads.clear();
+  m_uploading.clear();
+}
+
+void TileStreamer::build(const Request &_request, Built &o_built) const
+{
+  // a TileSize square grid centred on the origin, moved into place by the prefix
+  GridConfig local;
+  local.cellsX = local.cellsZ = TileSize;
+  local.step = _request.step;
+  local.scale = _request.scale;
+  const float x0 = static_cast<float>(_request.tx)*TileSize*_request.step;
+  const float z0 = static_cast<float>(_request.tz)*TileSize*_request.step;
+  ngl::Mat4 prefix;
+  prefix.m_m[3][0] = x0-local.originX();
+  prefix.m_m[3][2] = z0-local.originZ();
+  o_built.request = _request;
+  o_built.models.resize(TileCells);
+  o_built.colours.resize(TileCells);
+  GridKernel::computeMatrices(local, prefix, 0, TileCells, o_built.models.data());
+  // same colouring as GridKernel::computeColours but from the unbounded grid position
+  for(uint32_t iz = 0; iz < TileSize; ++iz)
+  {
+    const float z = z0+iz*_request.step;
+    for(uint32_t ix = 0; ix < TileSize; ++ix)
+    {
+      ngl::Vec4 colour(z, z, x0+ix*_request.step, 1.0f);
+      colour.normalize();
+      o_built.colours[iz*TileSize+ix] = colour;
+    }
+  }
+}
+
+void TileStreamer::builder()
+{
+  for(;;)
+  {
+    Request request;
+    Built built;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_wake.wait(lock, [this]{ return !m_queue.empty() || !m_running; });
+      if(!m_running)
+      {
+        return;
+      }
+      request = m_queue.front();
+      m_queue.pop_front();
+      ++m_building;
+      if(!m_spare.empty())
+      {
+        built = std::move(m_spare.back());
+        m_spare.pop_back();
+      }
+    }
+    build(request, built);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_done.push_back(std::move(built));
+    --m_building;
+  }
+}
+
+bool TileStreamer::acquireSlot(uint64_t _frame, uint32_t &o_slot)
+{
+  while(!m_retired.empty() && m_retired.front().second+StreamBuffer::Regions <= _frame)
+  {
+    m_freeSlots.push_back(m_retired.front().first);
+    m_retired.pop_front();
+  }
+  if(m_freeSlots.empty())
+  {
+    return false;
+  }
+  o_slot = m_freeSlots.back();
+  m_freeSlots.pop_back();
+  return true;
+}
+
+void TileStreamer::update(float _x, float _z, float _distance, uint64_t _frame, FrameArena &_arena)
+{
+  m_frame = _frame;
+  m_uploads.clear();
+  m_visible.clear();
+  const uint64_t evicted = m_stats.evicted;
+  m_stats = Stats();
+  m_stats.evicted = evicted;
+
+  // a square of tiles around the camera, no larger than the budget allows with room for a frame of uploads
+  const float tileExtent = TileSize*m_step;
+  const int32_t cx = static_cast<int32_t>(std::floor(_x/tileExtent));
+  const int32_t cz = static_cast<int32_t>(std::floor(_z/tileExtent));
+  const uint32_t spare = m_capacity > MaxUploads ? m_capacity-MaxUploads : 0;
+  const int32_t maxRadius = (static_cast<int32_t>(std::sqrt(static_cast<float>(spare)))-1)/2;
+  const int32_t radius = std::min(maxRadius, static_cast<int32_t>(std::ceil(_distance/tileExtent)));
+  if(radius < 0)
+  {
+    return;
+  }
+  m_stats.radius = static_cast<uint32_t>(radius);
+
+  struct Missing
+  {
+    int32_t d2;
+    int32_t tx;
+    int32_t tz;
+  };
+  Missing *missing = _arena.allocate<Missing>(static_cast<size_t>((2*radius+1)*(2*radius+1)));
+  size_t missingCount = 0;
+  for(int32_t dz = -radius; dz <= radius; ++dz)
+  {
+    for(int32_t dx = -radius; dx <= radius; ++dx)
+    {
+      auto found = m_entries.find(key(cx+dx, cz+dz));
+      if(found != m_entries.end())
+      {
+        found->second.tile.used = _frame;
+        m_lru.splice(m_lru.begin(), m_lru, found->second.lru);
+        m_visible.push_back(&found->second.tile);
+      }
+      else
+      {
+        missing[missingCount++] = {dx*dx+dz*dz, cx+dx, cz+dz};
+      }
+    }
+  }
+  m_stats.needed = static_cast<uint32_t>((2*radius+1)*(2*radius+1));
+  m_stats.missing = static_cast<uint32_t>(missingCount);
+  std::sort(missing, missing+missingCount, [](const Missing &_a, const Missing &_b){ return _a.d2 < _b.d2; });
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // last frame's uploads have been copied by now, their arrays are reused by the next builds
+    for(Built &built : m_uploading)
+    {
+      if(m_spare.size() < MaxUploads)
+      {
+        m_spare.push_back(std::move(built));
+      }
+    }
+    m_uploading.clear();
+    for(Built &built : m_done)
+    {
+      m_ready.push_back(std::move(built));
+    }
+    m_done.clear();
+    // requests the camera has moved away from are dropped before they are started
+    for(const Request &request : m_queue)
+    {
+      m_requested.erase(request.key);
+    }
+    m_queue.clear();
+    for(size_t i = 0; i < missingCount; ++i)
+    {
+      const Missing &tile = missing[i];
+      const uint64_t k = key(tile.tx, tile.tz);
+      if(m_requested.insert(k).second)
+      {
+        m_queue.push_back({k, tile.tx, tile.tz, m_step, m_scale, m_generation});
+      }
+    }
+    m_stats.queued = static_cast<uint32_t>(m_queue.size())+m_building;
+  }
+  // the builders only start once there is something to build, so the other modes never pay for them
+  if(m_threads.empty() && !m_queue.empty())
+  {
+    for(unsigned int i = 0; i < m_threadCount; ++i)
+    {
+      m_threads.emplace_back(&TileStreamer::builder, this);
+    }
+  }
+  m_wake.notify_all();
+
+  const float radiusCell = cellRadius();
+  while(!m_ready.empty() && m_uploads.size() < MaxUploads)
+  {
+    Built &built = m_ready.front();
+    const Request &request = built.request;
+    const bool inRange = std::abs(request.tx-cx) <= radius && std::abs(request.tz-cz) <= radius;
+    if(request.generation != m_generation || !inRange || m_entries.count(request.key) != 0)
+    {
+      m_requested.erase(request.key);
+      m_ready.pop_front();
+      continue;
+    }
+    uint32_t slot;
+    if(!acquireSlot(_frame, slot))
+    {
+      break;
+    }
+    Entry &entry = m_entries[request.key];
+    Tile &tile = entry.tile;
+    tile.tx = request.tx;
+    tile.tz = request.tz;
+    tile.slot = slot;
+    tile.min[0] = static_cast<float>(request.tx)*tileExtent-radiusCell;
+    tile.min[1] = -radiusCell;
+    tile.min[2] = static_cast<float>(request.tz)*tileExtent-radiusCell;
+    tile.max[0] = (static_cast<float>(request.tx)*TileSize+TileSize-1)*m_step+radiusCell;
+    tile.max[1] = radiusCell;
+    tile.max[2] = (static_cast<float>(request.tz)*TileSize+TileSize-1)*m_step+radiusCell;
+    tile.level = 0;
+    tile.used = _frame;
+    m_lru.push_front(request.key);
+    entry.lru = m_lru.begin();
+    m_visible.push_back(&tile);
+    m_requested.erase(request.key);
+    m_uploading.push_back(std::move(built));
+    m_ready.pop_front();
+    m_uploads.push_back({slot, m_uploading.back().models.data(), m_uploading.back().colours.data()});
+  }
+
+  // keep a frame of uploads worth of slots retired or free, evicting the tiles unused for longest
+  while(m_freeSlots.size()+m_retired.size() < MaxUploads && !m_lru.empty())
+  {
+    auto oldest = m_entries.find(m_lru.back());
+    if(oldest->second.tile.used == _frame)
+    {
+      break;
+    }
+    m_retired.push_back({oldest->second.tile.slot, _frame});
+    m_entries.erase(oldest);
+    m_lru.pop_back();
+    ++m_stats.evicted;
+  }
+  m_stats.uploaded = static_cast<uint32_t>(m_uploads.size());
+  m_stats.resident = static_cast<uint32_t>(m_entries.size());
+  m_stats.bytes = m_entries.size()*TileBytes;
+}
@@ -2,14 +2,27 @@
 basic OpenGL demo modified from http://qt-project.org/doc/qt-5.0/qtgui/openglwindow.html
 ****************************************************************************/
 #include <QtGui/QGuiApplication>
+#include <QCommandLineParser>
+#include <cstdlib>
 #include <iostream>
 #include "NGLScene.h"
+#include "GridOptions.h"
 
 
 
 int main(int argc, char **argv)
 {
   QGuiApplication app(argc, argv);
+  // the grid layout can be set on the command line, see --help
+  QCommandLineParser parser;
+  parser.setApplicationDescription("NGL teapot grid");
+  parser.addHelpOption();
+  GridOptions gridOptions(parser);
+  parser.process(app);
+  if(!gridOptions.valid())
+  {
+    return EXIT_FAILURE;
+  }
   // create an OpenGL format specifier
   QSurfaceFormat format;
   // set the number of samples for multisampling
@@ -29,8 +42,35 @@ int main(int argc, char **argv)
   format.setProfile(QSurfaceFormat::CoreProfile);
   // now set the depth buffer to 24 bits
   format.setDepthBufferSize(24);
+  // sync to vblank, with the coalescing in NGLScene a burst of input costs at most one frame per refresh
+  format.setSwapInterval(1);
   // now we are going to create our scene window
-  NGLScene window;
+  NGLScene window(gridOptions.config(), gridOptions.threads());
+  if(gridOptions.procedural())
+  {
+    window.renderer().setDrawMode(GridRenderer::DrawMode::Procedural);
+  }
+  if(gridOptions.streamed())
+  {
+    window.renderer().setDrawMode(GridRenderer::DrawMode::Streamed);
+  }
+  if(gridOptions.farPlane() > 0.0f)
+  {
+    window.renderer().setFarPlane(gridOptions.farPlane());
+  }
+  if(gridOptions.tileBudget() > 0)
+  {
+    window.renderer().setTileBudget(gridOptions.tileBudget());
+  }
+  int captureWidth;
+  int captureHeight;
+  gridOptions.captureSize(captureWidth, captureHeight);
+  window.setCaptureSize(captureWidth, captureHeight, gridOptions.captureRaw());
+  if(!gridOptions.captureDirectory().empty())
+  {
+    window.startCapture(gridOptions.captureDirectory());
+  }
+  window.setRenderThread(gridOptions.renderThread());
   // and set the OpenGL format
   window.setFormat(format);
   // we can now query the version to see if it worked